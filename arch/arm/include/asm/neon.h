@@ -0,0 +1,25 @@
+/*
+ *  arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+/*
+ * Below this size a copy or fill is not worth saving the live VFP state
+ * and taking the extra trap when its owner next uses it, so the ARM
+ * routines are used.
+ */
+#define NEON_COPY_MIN		1024
+
+#ifndef __ASSEMBLY__
+
+extern void kernel_neon_begin(void);
+extern void kernel_neon_end(void);
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_ARM_NEON_H */
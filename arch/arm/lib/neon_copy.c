@@ -0,0 +1,211 @@
+/*
+ *  linux/arch/arm/lib/neon_copy.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *  Dispatch of large memcpy(), memset() and copy_page() calls to the NEON
+ *  loops in memcpy_neon.S. The assembler entry points branch here for
+ *  sizes of at least NEON_COPY_MIN; we go back to the ARM routines when
+ *  NEON is not usable: before the boot-time check has run, on CPUs
+ *  without NEON, or in interrupt context, where the registers of the
+ *  interrupted kernel NEON user could be live.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/hardirq.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+
+extern void *__memcpy_arm(void *, const void *, size_t);
+extern void __memset_arm(void *, int, size_t);
+extern void __copy_page_arm(void *, const void *);
+
+extern void __memcpy_neon(void *, const void *, size_t);
+extern void __memset_neon(void *, int, size_t);
+extern void __copy_page_neon(void *, const void *);
+
+static int neon_copy_enabled __read_mostly;
+static int neon_copy_allowed __initdata = 1;
+
+static inline int neon_copy_usable(void)
+{
+	return neon_copy_enabled && !in_interrupt();
+}
+
+void *neon_memcpy(void *dest, const void *src, size_t n)
+{
+	if (!neon_copy_usable())
+		return __memcpy_arm(dest, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(dest, src, n);
+	kernel_neon_end();
+
+	return dest;
+}
+
+void *neon_memset(void *dest, int c, size_t n)
+{
+	if (!neon_copy_usable()) {
+		__memset_arm(dest, c, n);
+		return dest;
+	}
+
+	kernel_neon_begin();
+	__memset_neon(dest, c, n);
+	kernel_neon_end();
+
+	return dest;
+}
+
+void neon_memzero(void *dest, size_t n)
+{
+	neon_memset(dest, 0, n);
+}
+
+void neon_copy_page(void *to, const void *from)
+{
+	if (!neon_copy_usable()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+static int __init neon_copy_setup(char *str)
+{
+	neon_copy_allowed = simple_strtol(str, NULL, 0);
+	return 1;
+}
+__setup("neon_copy=", neon_copy_setup);
+
+/*
+ * Boot-time check: time the ARM and NEON variants over a buffer that fits
+ * in L2, and only switch to NEON if its page copies are faster. The
+ * kernel_neon_begin()/end() pair is included in the NEON timings, so
+ * the state switch overhead is accounted for.
+ */
+#define BENCH_ORDER	3
+#define BENCH_SIZE	(PAGE_SIZE << BENCH_ORDER)
+#define BENCH_LOOPS	64
+
+enum { BENCH_COPY_PAGE, BENCH_MEMCPY, BENCH_MEMSET, BENCH_NR };
+
+static const char *bench_names[BENCH_NR] __initdata = {
+	"copy_page", "memcpy", "memset",
+};
+
+static void __init neon_copy_run(int op, int neon, void *dst, void *src)
+{
+	unsigned long off;
+
+	switch (op) {
+	case BENCH_COPY_PAGE:
+		for (off = 0; off < BENCH_SIZE; off += PAGE_SIZE) {
+			if (neon) {
+				kernel_neon_begin();
+				__copy_page_neon(dst + off, src + off);
+				kernel_neon_end();
+			} else {
+				__copy_page_arm(dst + off, src + off);
+			}
+		}
+		break;
+	case BENCH_MEMCPY:
+		/* Misalign the source to exercise the general path */
+		if (neon) {
+			kernel_neon_begin();
+			__memcpy_neon(dst, src + 4, BENCH_SIZE - 4);
+			kernel_neon_end();
+		} else {
+			__memcpy_arm(dst, src + 4, BENCH_SIZE - 4);
+		}
+		break;
+	case BENCH_MEMSET:
+		if (neon) {
+			kernel_neon_begin();
+			__memset_neon(dst, 0, BENCH_SIZE);
+			kernel_neon_end();
+		} else {
+			__memset_arm(dst, 0, BENCH_SIZE);
+		}
+		break;
+	}
+}
+
+/* Returns MB/s */
+static unsigned int __init neon_copy_bench(int op, int neon,
+					void *dst, void *src)
+{
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	/* Warm the caches */
+	neon_copy_run(op, neon, dst, src);
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++)
+		neon_copy_run(op, neon, dst, src);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (!ns)
+		ns = 1;
+
+	return div64_u64((u64)BENCH_LOOPS * BENCH_SIZE * 1000, ns);
+}
+
+static int __init neon_copy_init(void)
+{
+	unsigned int arm[BENCH_NR], neon[BENCH_NR];
+	unsigned long src, dst;
+	int op;
+
+	if (!(elf_hwcap & HWCAP_NEON)) {
+		printk(KERN_INFO "NEON copy: no NEON unit, using ARM routines\n");
+		return 0;
+	}
+
+	if (!neon_copy_allowed) {
+		printk(KERN_INFO "NEON copy: disabled on command line\n");
+		return 0;
+	}
+
+	src = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst) {
+		printk(KERN_WARNING "NEON copy: no memory for benchmark, "
+			"using ARM routines\n");
+		goto out;
+	}
+	__memset_arm((void *)src, 0x5a, BENCH_SIZE);
+
+	for (op = 0; op < BENCH_NR; op++) {
+		arm[op] = neon_copy_bench(op, 0, (void *)dst, (void *)src);
+		neon[op] = neon_copy_bench(op, 1, (void *)dst, (void *)src);
+		printk(KERN_INFO "NEON copy: %-9s arm %5u MB/s, neon %5u MB/s\n",
+			bench_names[op], arm[op], neon[op]);
+	}
+
+	neon_copy_enabled = neon[BENCH_COPY_PAGE] > arm[BENCH_COPY_PAGE];
+	printk(KERN_INFO "NEON copy: using %s routines for copies of %d "
+		"bytes or more\n", neon_copy_enabled ? "NEON" : "ARM",
+		NEON_COPY_MIN);
+
+out:
+	if (dst)
+		free_pages(dst, BENCH_ORDER);
+	if (src)
+		free_pages(src, BENCH_ORDER);
+	return 0;
+}
+/* Must run after vfp_init(), which is a late_initcall too */
+late_initcall_sync(neon_copy_init);
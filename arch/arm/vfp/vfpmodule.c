@@ -14,9 +14,11 @@
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/init.h>
+#include <linux/hardirq.h>
 
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
+#include <asm/neon.h>
 
 #include "vfpinstr.h"
 #include "vfp.h"
@@ -524,6 +526,48 @@ out:
 }
 #endif
 
+#ifdef CONFIG_NEON
+/*
+ * Kernel mode NEON. The caller must not be in interrupt context; between
+ * kernel_neon_begin() and kernel_neon_end() preemption is disabled and the
+ * NEON registers may be clobbered freely. Whatever thread state was live
+ * in the registers is saved first, and the unit is left disabled with no
+ * owner afterwards so that the next VFP instruction of that thread traps
+ * and reloads its state.
+ */
+void kernel_neon_begin(void)
+{
+	unsigned int cpu;
+	u32 fpexc;
+
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC);
+	fmxr(FPEXC, fpexc | FPEXC_EN);
+	isb();
+
+#ifdef CONFIG_SMP
+	/* On SMP, the registers hold live state only if VFP is enabled */
+	if ((fpexc & FPEXC_EN) && last_VFP_context[cpu]) {
+		last_VFP_context[cpu]->hard.cpu = cpu;
+#else
+	if (last_VFP_context[cpu]) {
+#endif
+		vfp_save_state(last_VFP_context[cpu], fpexc | FPEXC_EN);
+		last_VFP_context[cpu] = NULL;
+	}
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+#endif
+
 #include <linux/smp.h>
 
 /*
@@ -163,10 +163,13 @@ static ssize_t queue_nonrot_store(struct request_queue *q, const char *page,
 	ssize_t ret = queue_var_store(&nm, page, count);
 
 	spin_lock_irq(q->queue_lock);
-	if (nm)
+	if (nm) {
 		queue_flag_clear(QUEUE_FLAG_NONROT, q);
-	else
+		q->backing_dev_info.capabilities &= ~BDI_CAP_NO_SEEK_PENALTY;
+	} else {
 		queue_flag_set(QUEUE_FLAG_NONROT, q);
+		q->backing_dev_info.capabilities |= BDI_CAP_NO_SEEK_PENALTY;
+	}
 	spin_unlock_irq(q->queue_lock);
 
 	return ret;
@@ -0,0 +1,569 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Based on the deadline i/o scheduler, Copyright (C) 2002 Jens Axboe.
+ *
+ *  Flash media (eMMC, SD) has no seek penalty, but writes are far more
+ *  expensive than reads and are cheapest when they arrive grouped by
+ *  erase block.  This scheduler therefore:
+ *
+ *   - serves synchronous requests (reads, O_SYNC/fsync writes) in plain
+ *     FIFO order, ahead of background writes, and once one has waited
+ *     sync_expire it is served even in the middle of a write batch;
+ *   - dispatches asynchronous writes in batches confined to one erase
+ *     block, in ascending sector order, so the card sees them together;
+ *   - keeps a cost account for each class, where a written sector is
+ *     charged write_cost times as much as a read sector, and uses it to
+ *     decide when background writes are due.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+
+enum { ASYNC, SYNC };
+
+static const int sync_expire = HZ / 4;	/* max time before a sync req is submitted */
+static const int async_expire = 5 * HZ;	/* ditto for async writes, SOFT limit */
+static const int async_starved = 4;	/* sync cost, in erase blocks, before writes get a turn */
+static const int erase_block_kb = 512;	/* typical eMMC/SD erase block */
+static const int write_cost = 4;	/* cost of a written sector vs a read one */
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are present on both sort_list and fifo_list, indexed
+	 * by ASYNC/SYNC
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[2];
+
+	/*
+	 * next async write of the current batch, and the end of the erase
+	 * block the batch is confined to
+	 */
+	struct request *next_async;
+	sector_t batch_end;
+
+	/* cost dispatched from the sync queue since the last write batch */
+	unsigned long sync_debt;
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[2];
+	int async_starved;
+	int erase_block_kb;
+	int write_cost;
+	int front_merges;
+
+	/*
+	 * statistics, exported through sysfs
+	 */
+	unsigned long dispatched[2];		/* requests */
+	unsigned long long cost[2];		/* sectors, weighted */
+	unsigned long write_batches;
+	unsigned long sync_wait_total;		/* jiffies */
+	unsigned long sync_wait_max;		/* jiffies */
+	unsigned long sync_completed;
+};
+
+static inline int flash_rq_sync(struct request *rq)
+{
+	return rq_is_sync(rq) ? SYNC : ASYNC;
+}
+
+static inline int flash_bio_sync(struct bio *bio)
+{
+	if (bio_data_dir(bio) == READ || bio_rw_flagged(bio, BIO_RW_SYNCIO))
+		return SYNC;
+	return ASYNC;
+}
+
+static inline sector_t flash_erase_block_sectors(struct flash_data *fd)
+{
+	return (sector_t)fd->erase_block_kb << 1;
+}
+
+static void flash_move_request(struct flash_data *, struct request *);
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[flash_rq_sync(rq)];
+}
+
+/*
+ * get the request after `rq' in sector-sorted order
+ */
+static inline struct request *
+flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_request(fd, __alias);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	if (fd->next_async == rq)
+		fd->next_async = flash_latter_request(rq);
+
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int sync = flash_rq_sync(rq);
+
+	flash_add_rq_rb(fd, rq);
+
+	/*
+	 * set expire time and add to fifo list
+	 */
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[sync]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[sync]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[flash_bio_sync(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(flash_rb_root(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * Requests that would merge across classes are kept apart, so a
+ * background write never drags a foreground read behind it.
+ */
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	return flash_rq_sync(rq) == flash_bio_sync(bio);
+}
+
+/*
+ * charge rq to its class and move it to the dispatch queue
+ */
+static void
+flash_move_request(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	const int sync = flash_rq_sync(rq);
+	unsigned long cost = blk_rq_sectors(rq);
+
+	if (rq_data_dir(rq) == WRITE)
+		cost *= fd->write_cost;
+
+	fd->dispatched[sync]++;
+	fd->cost[sync] += cost;
+	if (sync == SYNC)
+		fd->sync_debt += cost;
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * flash_check_fifo returns 0 if there are no expired requests on the fifo,
+ * 1 otherwise. Requires !list_empty(&fd->fifo_list[sync])
+ */
+static inline int flash_check_fifo(struct flash_data *fd, int sync)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[sync].next);
+
+	/*
+	 * rq is expired!
+	 */
+	if (time_after(jiffies, rq_fifo_time(rq)))
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Background writes get a turn once the sync queue has been charged
+ * async_starved erase blocks worth of cost since the last write batch,
+ * or when the oldest write has expired.
+ */
+static inline int flash_async_due(struct flash_data *fd)
+{
+	unsigned long limit = fd->async_starved *
+			      (unsigned long)flash_erase_block_sectors(fd);
+
+	return fd->sync_debt >= limit || flash_check_fifo(fd, ASYNC);
+}
+
+/*
+ * Start a write batch in the erase block holding the oldest write,
+ * beginning with the lowest-sectored write queued in that block.
+ */
+static struct request *flash_start_write_batch(struct flash_data *fd)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[ASYNC].next);
+	sector_t eb = flash_erase_block_sectors(fd);
+	sector_t start = blk_rq_pos(rq);
+	struct rb_node *node;
+
+	sector_div(start, eb);
+	start *= eb;
+
+	while ((node = rb_prev(&rq->rb_node)) != NULL &&
+	       blk_rq_pos(rb_entry_rq(node)) >= start)
+		rq = rb_entry_rq(node);
+
+	fd->batch_end = start + eb;
+	fd->sync_debt = 0;
+	fd->write_batches++;
+
+	return rq;
+}
+
+/*
+ * flash_dispatch_requests selects the best request according to
+ * sync/async class, expiry and erase block batching
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int syncs = !list_empty(&fd->fifo_list[SYNC]);
+	const int asyncs = !list_empty(&fd->fifo_list[ASYNC]);
+	struct request *rq;
+
+	/*
+	 * an expired sync request cuts into the current write batch,
+	 * which resumes afterwards, unless writes have expired too
+	 */
+	if (syncs && flash_check_fifo(fd, SYNC) &&
+	    !(asyncs && flash_check_fifo(fd, ASYNC)))
+		goto dispatch_sync;
+
+	/*
+	 * finish the current write batch while it stays within its
+	 * erase block
+	 */
+	rq = fd->next_async;
+	if (rq && blk_rq_pos(rq) < fd->batch_end)
+		goto dispatch_async;
+
+	if (syncs) {
+		if (asyncs && flash_async_due(fd))
+			goto dispatch_writes;
+
+dispatch_sync:
+		/*
+		 * there is no seek penalty to optimise for, so sync
+		 * requests simply go out in arrival order
+		 */
+		flash_move_request(fd, rq_entry_fifo(fd->fifo_list[SYNC].next));
+		return 1;
+	}
+
+	if (asyncs) {
+dispatch_writes:
+		rq = flash_start_write_batch(fd);
+		goto dispatch_async;
+	}
+
+	return 0;
+
+dispatch_async:
+	fd->next_async = flash_latter_request(rq);
+	flash_move_request(fd, rq);
+
+	return 1;
+}
+
+static int flash_queue_empty(struct request_queue *q)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	return list_empty(&fd->fifo_list[ASYNC])
+		&& list_empty(&fd->fifo_list[SYNC]);
+}
+
+static void flash_completed_request(struct request_queue *q,
+				    struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	unsigned long wait;
+
+	if (!rq_is_sync(rq))
+		return;
+
+	wait = jiffies - rq->start_time;
+	fd->sync_wait_total += wait;
+	if (wait > fd->sync_wait_max)
+		fd->sync_wait_max = wait;
+	fd->sync_completed++;
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	BUG_ON(!list_empty(&fd->fifo_list[SYNC]));
+	BUG_ON(!list_empty(&fd->fifo_list[ASYNC]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	INIT_LIST_HEAD(&fd->fifo_list[SYNC]);
+	INIT_LIST_HEAD(&fd->fifo_list[ASYNC]);
+	fd->sort_list[SYNC] = RB_ROOT;
+	fd->sort_list[ASYNC] = RB_ROOT;
+	fd->fifo_expire[SYNC] = sync_expire;
+	fd->fifo_expire[ASYNC] = async_expire;
+	fd->async_starved = async_starved;
+	fd->erase_block_kb = erase_block_kb;
+	fd->write_cost = write_cost;
+	fd->front_merges = 1;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_sync_expire_show, fd->fifo_expire[SYNC], 1);
+SHOW_FUNCTION(flash_async_expire_show, fd->fifo_expire[ASYNC], 1);
+SHOW_FUNCTION(flash_async_starved_show, fd->async_starved, 0);
+SHOW_FUNCTION(flash_erase_block_kb_show, fd->erase_block_kb, 0);
+SHOW_FUNCTION(flash_write_cost_show, fd->write_cost, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_sync_expire_store, &fd->fifo_expire[SYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_expire_store, &fd->fifo_expire[ASYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_starved_store, &fd->async_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_erase_block_kb_store, &fd->erase_block_kb, 4, 65536, 0);
+STORE_FUNCTION(flash_write_cost_store, &fd->write_cost, 1, 64, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+/*
+ * Per-class dispatch counts and weighted cost, plus the queue-to-
+ * completion latency seen by sync requests.  Reading this before and
+ * after a workload is enough to compare against other schedulers'
+ * throughput as seen by the same workload.
+ */
+static ssize_t flash_stats_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+	unsigned long avg = 0;
+
+	if (fd->sync_completed)
+		avg = fd->sync_wait_total / fd->sync_completed;
+
+	return sprintf(page,
+		"sync_dispatched %lu\n"
+		"sync_cost %llu\n"
+		"async_dispatched %lu\n"
+		"async_cost %llu\n"
+		"write_batches %lu\n"
+		"sync_wait_avg_ms %u\n"
+		"sync_wait_max_ms %u\n",
+		fd->dispatched[SYNC], fd->cost[SYNC],
+		fd->dispatched[ASYNC], fd->cost[ASYNC],
+		fd->write_batches,
+		jiffies_to_msecs(avg),
+		jiffies_to_msecs(fd->sync_wait_max));
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(sync_expire),
+	FD_ATTR(async_expire),
+	FD_ATTR(async_starved),
+	FD_ATTR(erase_block_kb),
+	FD_ATTR(write_cost),
+	FD_ATTR(front_merges),
+	__ATTR(stats, S_IRUGO, flash_stats_show, NULL),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_queue_empty_fn =	flash_queue_empty,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Flash-aware IO scheduler");
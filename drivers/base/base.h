@@ -1,3 +1,5 @@
+#include <linux/async.h>
+#include <linux/ktime.h>
 
 /**
  * struct bus_type_private - structure to hold the private to the driver core portions of the bus_type structure.
@@ -33,6 +35,10 @@ struct driver_private {
 	struct klist_node knode_bus;
 	struct module_kobject *mkobj;
 	struct device_driver *driver;
+	async_cookie_t probe_cookie;
+	ktime_t probe_queued;
+	struct task_struct *probe_task;	/* running the async attach */
+	struct list_head probe_entry;
 };
 #define to_driver(obj) container_of(obj, struct driver_private, kobj)
 
@@ -19,6 +19,7 @@
 
 #include <linux/device.h>
 #include <linux/delay.h>
+#include <linux/init.h>
 #include <linux/module.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
@@ -101,9 +102,15 @@ EXPORT_SYMBOL_GPL(device_bind_driver);
 static atomic_t probe_count = ATOMIC_INIT(0);
 static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
+static inline int probe_debug(void)
+{
+	return initcall_debug && system_state == SYSTEM_BOOTING;
+}
+
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
+	ktime_t calltime = ktime_get();
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
@@ -150,6 +157,11 @@ probe_failed:
 	 */
 	ret = 0;
 done:
+	if (probe_debug())
+		printk("probe of %s by %s returned after %lld usecs @ %i\n",
+		       dev_name(dev), drv->name,
+		       ktime_us_delta(ktime_get(), calltime),
+		       task_pid_nr(current));
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
@@ -287,6 +299,124 @@ static int __driver_attach(struct device *dev, void *data)
 	return 0;
 }
 
+/*
+ * Drivers that set probe_async are attached from an async thread, so
+ * that probes spent mostly in msleep() waiting for a part to come out of
+ * reset overlap with each other and with the rest of the initcalls.
+ * async_synchronize_full() in wait_for_device_probe() and before the
+ * init sections are freed is the final barrier; a probe that needs a
+ * device of an async driver calls wait_for_driver_probe() first.
+ * Booting with async_probe=0 attaches every driver synchronously.
+ *
+ * With initcall_debug, every probe is timed, and when the last pending
+ * async attach finishes a summary names the one that finished last:
+ * that attach is the critical path of the burst.
+ */
+static int async_probe = 1;
+core_param(async_probe, async_probe, bool, 0644);
+
+static DEFINE_SPINLOCK(async_probe_lock);
+static LIST_HEAD(async_probe_running);
+static int async_probe_pending;
+static int async_probe_drivers;
+static ktime_t async_probe_first;
+static s64 async_probe_busy_us;
+
+static void async_probe_queued(struct device_driver *drv)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&async_probe_lock, flags);
+	drv->p->probe_queued = ktime_get();
+	if (!async_probe_pending++) {
+		async_probe_first = drv->p->probe_queued;
+		async_probe_drivers = 0;
+		async_probe_busy_us = 0;
+	}
+	spin_unlock_irqrestore(&async_probe_lock, flags);
+}
+
+static void async_probe_done(struct device_driver *drv, ktime_t calltime)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&async_probe_lock, flags);
+	async_probe_drivers++;
+	async_probe_busy_us += ktime_us_delta(now, calltime);
+	if (!--async_probe_pending && probe_debug())
+		printk("async probe: %d drivers done after %lld usecs, "
+		       "%lld usecs of attaching; critical path %s: "
+		       "queued %lld usecs, attached in %lld usecs\n",
+		       async_probe_drivers,
+		       ktime_us_delta(now, async_probe_first),
+		       async_probe_busy_us, drv->name,
+		       ktime_us_delta(calltime, drv->p->probe_queued),
+		       ktime_us_delta(now, calltime));
+	spin_unlock_irqrestore(&async_probe_lock, flags);
+}
+
+static void driver_attach_async(void *data, async_cookie_t cookie)
+{
+	struct device_driver *drv = data;
+	ktime_t calltime = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&async_probe_lock, flags);
+	drv->p->probe_cookie = cookie;
+	drv->p->probe_task = current;
+	list_add(&drv->p->probe_entry, &async_probe_running);
+	spin_unlock_irqrestore(&async_probe_lock, flags);
+
+	bus_for_each_dev(drv->bus, NULL, drv, __driver_attach);
+
+	spin_lock_irqsave(&async_probe_lock, flags);
+	list_del(&drv->p->probe_entry);
+	drv->p->probe_task = NULL;
+	spin_unlock_irqrestore(&async_probe_lock, flags);
+	async_probe_done(drv, calltime);
+}
+
+/**
+ * wait_for_driver_probe
+ * @drv: driver another probe depends on.
+ *
+ * Wait until the devices present when @drv was registered have been
+ * probed, which only takes time if @drv sets probe_async. Asynchronous
+ * attaches queued before @drv's are waited for as well.
+ *
+ * Returns -ENODEV if @drv is not registered yet, so nothing can be
+ * waited for, and -EDEADLK, with a warning, if called from an async
+ * attach that @drv's would have to wait for. Returns 0 otherwise.
+ */
+int wait_for_driver_probe(struct device_driver *drv)
+{
+	struct driver_private *p;
+	async_cookie_t cookie;
+	unsigned long flags;
+	const char *self = NULL;
+
+	if (!drv->p)
+		return -ENODEV;
+
+	spin_lock_irqsave(&async_probe_lock, flags);
+	cookie = drv->p->probe_cookie;
+	list_for_each_entry(p, &async_probe_running, probe_entry)
+		if (p->probe_task == current && p->probe_cookie <= cookie)
+			self = p->driver->name;
+	spin_unlock_irqrestore(&async_probe_lock, flags);
+
+	if (!cookie)
+		return 0;
+	if (WARN(self, "async probe of %s cannot wait for %s, "
+		 "queued after it\n", self, drv->name))
+		return -EDEADLK;
+
+	async_synchronize_cookie(cookie + 1);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(wait_for_driver_probe);
+
 /**
  * driver_attach - try to bind driver to devices.
  * @drv: driver.
@@ -295,9 +425,17 @@ static int __driver_attach(struct device *dev, void *data)
  * match the driver with each one.  If driver_probe_device()
  * returns 0 and the @dev->driver is set, we've found a
  * compatible pair.
+ *
+ * If @drv->probe_async is set the walk is only queued, and errors
+ * are not reported back.
  */
 int driver_attach(struct device_driver *drv)
 {
+	if (drv->probe_async && async_probe) {
+		async_probe_queued(drv);
+		drv->p->probe_cookie = async_schedule(driver_attach_async, drv);
+		return 0;
+	}
 	return bus_for_each_dev(drv->bus, NULL, drv, __driver_attach);
 }
 EXPORT_SYMBOL_GPL(driver_attach);
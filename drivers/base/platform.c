@@ -531,6 +531,8 @@ int __init_or_module platform_driver_probe(struct platform_driver *drv,
 
 	/* temporary section violation during probe() */
 	drv->probe = probe;
+	/* the probe must have run by the time we check for bound devices */
+	drv->driver.probe_async = false;
 	retval = code = platform_driver_register(drv);
 
 	/*
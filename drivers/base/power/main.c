@@ -26,6 +26,7 @@
 #include <linux/rwsem.h>
 #include <linux/interrupt.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
 
 #include "../base.h"
 #include "power.h"
@@ -340,6 +341,7 @@ static void pm_dev_err(struct device *dev, pm_message_t state, char *info,
  */
 static int device_resume_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t calltime = ktime_get();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -353,6 +355,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
  End:
+	dpm_report_time(dev, "resume_early", calltime, error);
 	TRACE_RESUME(error);
 	return error;
 }
@@ -391,6 +394,7 @@ EXPORT_SYMBOL_GPL(dpm_resume_noirq);
  */
 static int device_resume(struct device *dev, pm_message_t state)
 {
+	ktime_t calltime = ktime_get();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -437,6 +441,7 @@ static int device_resume(struct device *dev, pm_message_t state)
  End:
 	up(&dev->sem);
 
+	dpm_report_time(dev, "resume", calltime, error);
 	TRACE_RESUME(error);
 	return error;
 }
@@ -634,15 +639,18 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  */
 static int device_suspend_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t calltime;
 	int error = 0;
 
 	if (!dev->bus)
 		return 0;
 
+	calltime = ktime_get();
 	if (dev->bus->pm) {
 		pm_dev_dbg(dev, state, "LATE ");
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
+	dpm_report_time(dev, "suspend_late", calltime, error);
 	return error;
 }
 
@@ -682,6 +690,7 @@ EXPORT_SYMBOL_GPL(dpm_suspend_noirq);
  */
 static int device_suspend(struct device *dev, pm_message_t state)
 {
+	ktime_t calltime = ktime_get();
 	int error = 0;
 
 	down(&dev->sem);
@@ -728,6 +737,7 @@ static int device_suspend(struct device *dev, pm_message_t state)
  End:
 	up(&dev->sem);
 
+	dpm_report_time(dev, "suspend", calltime, error);
 	return error;
 }
 //DIV5-CONN-MW-POWER SAVING MODE-06+[	
@@ -902,6 +912,7 @@ int dpm_suspend_start(pm_message_t state)
  	
  //DIV5-CONN-MW-POWER SAVING MODE-04-]	
 	might_sleep();
+	dpm_timing_start();
 	error = dpm_prepare(state);
 	if (!error)
 		error = dpm_suspend(state);
@@ -30,6 +30,14 @@ extern void device_pm_move_before(struct device *, struct device *);
 extern void device_pm_move_after(struct device *, struct device *);
 extern void device_pm_move_last(struct device *);
 
+/*
+ * timing.c
+ */
+
+extern void dpm_timing_start(void);
+extern void dpm_report_time(struct device *dev, const char *pm_ops,
+			    ktime_t start, int error);
+
 #else /* !CONFIG_PM_SLEEP */
 
 static inline void device_pm_init(struct device *dev)
@@ -0,0 +1,158 @@
+/*
+ * drivers/base/power/timing.c - Where the time goes in a system suspend.
+ *
+ * This file is released under the GPLv2
+ *
+ * Every device suspend, suspend_late, resume_early and resume callback
+ * and a few system-wide steps (sys_sync, waiting for it, and freezing
+ * tasks while polling the wake locks) are timed. Each measurement is
+ * emitted as a tracepoint. The slowest device callbacks of the last
+ * suspend/resume cycle and the last duration of each step are also kept
+ * for debugfs/pm_timing, so that a slow wakeup can be pinned on a driver
+ * without tracing enabled beforehand.
+ */
+
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
+#include <trace/events/power.h>
+
+#include "power.h"
+
+#define DPM_TIMING_SLOWEST	16
+
+struct dpm_timing {
+	char		device[24];
+	char		driver[16];
+	const char	*pm_ops;
+	unsigned int	usecs;
+	int		error;
+};
+
+/* Slowest callbacks of the current cycle, longest first */
+static struct dpm_timing dpm_slowest[DPM_TIMING_SLOWEST];
+static int dpm_slowest_nr;
+
+static const char *pm_step_names[PM_STEP_COUNT] = {
+	[PM_STEP_SYS_SYNC]	= "sys_sync",
+	[PM_STEP_SYNC_WAIT]	= "sys_sync_wait",
+	[PM_STEP_FREEZE]	= "freeze",
+};
+
+static unsigned int pm_step_usecs[PM_STEP_COUNT];
+
+static DEFINE_SPINLOCK(dpm_timing_lock);
+
+static inline unsigned int usecs_since(ktime_t start)
+{
+	return ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+/**
+ * dpm_timing_start - Forget the device timings of the previous cycle.
+ */
+void dpm_timing_start(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	dpm_slowest_nr = 0;
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ * dpm_report_time - Account for a device PM callback.
+ * @dev: Device whose callback returned.
+ * @pm_ops: Phase, e.g. "suspend" or "resume_early".
+ * @start: Time the callback was started.
+ * @error: Its return value.
+ */
+void dpm_report_time(struct device *dev, const char *pm_ops, ktime_t start,
+		     int error)
+{
+	struct dpm_timing *t;
+	unsigned int usecs = usecs_since(start);
+	unsigned long flags;
+	int i;
+
+	trace_device_pm_report_time(dev, pm_ops, usecs, error);
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	for (i = dpm_slowest_nr; i > 0; i--)
+		if (dpm_slowest[i - 1].usecs >= usecs)
+			break;
+	if (i < DPM_TIMING_SLOWEST) {
+		if (dpm_slowest_nr < DPM_TIMING_SLOWEST)
+			dpm_slowest_nr++;
+		memmove(&dpm_slowest[i + 1], &dpm_slowest[i],
+			(dpm_slowest_nr - i - 1) * sizeof(*t));
+		t = &dpm_slowest[i];
+		strlcpy(t->device, dev_name(dev), sizeof(t->device));
+		strlcpy(t->driver, dev_driver_string(dev), sizeof(t->driver));
+		t->pm_ops = pm_ops;
+		t->usecs = usecs;
+		t->error = error;
+	}
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ * pm_report_step_time - Account for a system-wide suspend step.
+ * @step: PM_STEP_* value.
+ * @start: Time the step was started.
+ */
+void pm_report_step_time(int step, ktime_t start)
+{
+	unsigned int usecs = usecs_since(start);
+
+	trace_pm_step_time(pm_step_names[step], usecs);
+	pm_step_usecs[step] = usecs;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int pm_timing_show(struct seq_file *m, void *unused)
+{
+	struct dpm_timing slowest[DPM_TIMING_SLOWEST];
+	unsigned long flags;
+	int i, nr;
+
+	for (i = 0; i < PM_STEP_COUNT; i++)
+		seq_printf(m, "%-16s %10u us\n", pm_step_names[i],
+			   pm_step_usecs[i]);
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	nr = dpm_slowest_nr;
+	memcpy(slowest, dpm_slowest, nr * sizeof(*slowest));
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+
+	seq_printf(m, "\nslowest device callbacks of the last cycle:\n");
+	for (i = 0; i < nr; i++)
+		seq_printf(m, "%-12s %10u us  %s (%s)%s\n", slowest[i].pm_ops,
+			   slowest[i].usecs, slowest[i].device,
+			   slowest[i].driver, slowest[i].error ? " failed" : "");
+	return 0;
+}
+
+static int pm_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_timing_show, NULL);
+}
+
+static const struct file_operations pm_timing_fops = {
+	.open		= pm_timing_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pm_timing_init(void)
+{
+	debugfs_create_file("pm_timing", S_IRUGO, NULL, NULL, &pm_timing_fops);
+	return 0;
+}
+late_initcall(pm_timing_init);
+#endif /* CONFIG_DEBUG_FS */
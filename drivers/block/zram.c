@@ -0,0 +1,848 @@
+/*
+ * Compressed RAM block device.
+ *
+ * Every PAGE_SIZE block written to the device is compressed with LZO and
+ * kept in a small size-class allocator, so the device costs only as much
+ * RAM as its contents compress to. It is meant to be used as a swap
+ * device on machines without backing storage for swap:
+ *
+ *	echo $((64 * 1024 * 1024)) > /sys/block/zram0/disksize
+ *	mkswap /dev/block/zram0
+ *	swapon /dev/block/zram0
+ *
+ * Pages that are entirely zero take no storage at all, and pages that do
+ * not compress well are kept as they are. The swap layer tells us when a
+ * slot is released (swap_slot_free_notify), so memory is given back as
+ * soon as a page is swapped in for good rather than when it is next
+ * overwritten.
+ *
+ * Parts derived from drivers/block/brd.c.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/highmem.h>
+#include <linux/genhd.h>
+#include <linux/device.h>
+#include <linux/buffer_head.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include <linux/math64.h>
+#include <linux/lzo.h>
+
+#define SECTOR_SHIFT		9
+#define PAGE_SECTORS_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
+#define PAGE_SECTORS		(1 << PAGE_SECTORS_SHIFT)
+
+/*
+ * Compressed objects are rounded up to ZRAM_CLASS_SIZE bytes and carved
+ * out of pages dedicated to one size class. A page holds
+ * PAGE_SIZE / class_size objects, so anything larger than half a page
+ * would get a page to itself anyway: such pages are stored uncompressed.
+ */
+#define ZRAM_CLASS_SHIFT	5
+#define ZRAM_CLASS_SIZE		(1 << ZRAM_CLASS_SHIFT)
+#define ZRAM_MAX_ZPAGE_SIZE	(PAGE_SIZE / 2)
+#define ZRAM_NR_CLASSES		(ZRAM_MAX_ZPAGE_SIZE >> ZRAM_CLASS_SHIFT)
+
+/* Marks the end of a pool page's free object list */
+#define ZRAM_FREE_END		0xffff
+
+/* Flags for zram_table_entry */
+enum zram_pageflags {
+	ZRAM_ZERO,		/* page is all zeroes, nothing stored */
+	ZRAM_UNCOMPRESSED,	/* page stored as is in a page of its own */
+};
+
+/*
+ * One entry per PAGE_SIZE block of the device. @page is either a pool
+ * page holding the compressed object at @offset, or (ZRAM_UNCOMPRESSED)
+ * a private copy of the data.
+ */
+struct zram_table_entry {
+	struct page	*page;
+	u16		offset;
+	u16		size;
+	u8		flags;
+};
+
+/*
+ * A size class keeps the pool pages that still have free objects. For
+ * pages we own, page->private is the offset of the first free object
+ * (each free object holds the offset of the next one) and page->index
+ * counts the objects in use.
+ */
+struct zram_class {
+	struct list_head	partial;
+};
+
+struct zram_stats {
+	u64		num_reads;
+	u64		num_writes;
+	u64		invalid_io;
+	u64		notify_free;
+	unsigned long	zero_pages;
+	unsigned long	good_compress;	/* pages compressed to <= 1/4 */
+	unsigned long	pages_stored;	/* compressed objects */
+	unsigned long	pages_expand;	/* pages stored uncompressed */
+	unsigned long	pool_pages;	/* pages backing size classes */
+	u64		compr_size;	/* bytes of compressed data */
+};
+
+struct zram {
+	int			number;
+	struct request_queue	*queue;
+	struct gendisk		*disk;
+
+	/*
+	 * @init_lock serialises (re)configuration; @lock guards the
+	 * compression buffers. Table and pool are protected by
+	 * @pool_lock, which is a spinlock because slot free notification
+	 * comes in under swap_lock.
+	 */
+	struct mutex		init_lock;
+	struct mutex		lock;
+	spinlock_t		pool_lock;
+	int			init_done;
+
+	u64			disksize;	/* bytes */
+	struct zram_table_entry	*table;
+	struct zram_class	classes[ZRAM_NR_CLASSES];
+	void			*compress_workmem;
+	void			*compress_buffer;
+
+	struct zram_stats	stats;
+};
+
+static int zram_major;
+static struct zram *zram_devices;
+
+static unsigned int num_devices = 1;
+module_param(num_devices, uint, 0);
+MODULE_PARM_DESC(num_devices, "Number of zram devices");
+static unsigned long disksize_kb;
+module_param(disksize_kb, ulong, 0);
+MODULE_PARM_DESC(disksize_kb,
+		"Size of each zram device in kbytes, 0 to configure through sysfs");
+
+static int zram_test_flag(struct zram *zram, u32 index,
+			enum zram_pageflags flag)
+{
+	return zram->table[index].flags & (1 << flag);
+}
+
+static void zram_set_flag(struct zram *zram, u32 index,
+			enum zram_pageflags flag)
+{
+	zram->table[index].flags |= (1 << flag);
+}
+
+static inline int zram_class_index(size_t size)
+{
+	return (size - 1) >> ZRAM_CLASS_SHIFT;
+}
+
+static inline size_t zram_class_size(int class)
+{
+	return (class + 1) << ZRAM_CLASS_SHIFT;
+}
+
+/*
+ * Pool allocator
+ */
+
+static void zram_pool_page_init(struct page *page, size_t size)
+{
+	unsigned char *base = page_address(page);
+	unsigned int off;
+
+	for (off = 0; off + size <= PAGE_SIZE; off += size) {
+		u16 next = off + size;
+
+		if (next + size > PAGE_SIZE)
+			next = ZRAM_FREE_END;
+		*(u16 *)(base + off) = next;
+	}
+	set_page_private(page, 0);
+	page->index = 0;
+}
+
+/*
+ * Take an object out of @page. Caller holds pool_lock. The page is
+ * dropped from the partial list once it is full.
+ */
+static u16 zram_pool_take(struct page *page)
+{
+	unsigned char *base = page_address(page);
+	u16 off = page_private(page);
+
+	set_page_private(page, *(u16 *)(base + off));
+	page->index++;
+	if (page_private(page) == ZRAM_FREE_END)
+		list_del_init(&page->lru);
+
+	return off;
+}
+
+/*
+ * Allocate an object of @size bytes. Called with pool_lock held; the lock
+ * is dropped if a new page is needed, so the caller must not rely on
+ * state read before the call.
+ */
+static int zram_pool_alloc(struct zram *zram, size_t size,
+			struct page **pagep, u16 *offset)
+{
+	int class = zram_class_index(size);
+	struct zram_class *zc = &zram->classes[class];
+	struct page *page;
+
+	if (list_empty(&zc->partial)) {
+		spin_unlock(&zram->pool_lock);
+		page = alloc_page(GFP_NOIO | __GFP_NOWARN);
+		spin_lock(&zram->pool_lock);
+		if (!page)
+			return -ENOMEM;
+		zram_pool_page_init(page, zram_class_size(class));
+		list_add(&page->lru, &zc->partial);
+		zram->stats.pool_pages++;
+	}
+
+	page = list_first_entry(&zc->partial, struct page, lru);
+	*offset = zram_pool_take(page);
+	*pagep = page;
+
+	return 0;
+}
+
+static void zram_pool_free(struct zram *zram, struct page *page, u16 offset,
+			size_t size)
+{
+	int class = zram_class_index(size);
+	unsigned char *base = page_address(page);
+
+	if (page_private(page) == ZRAM_FREE_END)
+		list_add(&page->lru, &zram->classes[class].partial);
+
+	*(u16 *)(base + offset) = page_private(page);
+	set_page_private(page, offset);
+
+	if (--page->index == 0) {
+		list_del(&page->lru);
+		set_page_private(page, 0);
+		__free_page(page);
+		zram->stats.pool_pages--;
+	}
+}
+
+/*
+ * Release whatever backs block @index. Caller holds pool_lock.
+ */
+static void zram_free_page(struct zram *zram, u32 index)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+
+	if (zram_test_flag(zram, index, ZRAM_ZERO)) {
+		zram->stats.zero_pages--;
+		goto out;
+	}
+
+	if (!entry->page)
+		return;
+
+	if (zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
+		__free_page(entry->page);
+		zram->stats.pages_expand--;
+		goto out;
+	}
+
+	if (entry->size <= PAGE_SIZE / 4)
+		zram->stats.good_compress--;
+	zram->stats.compr_size -= entry->size;
+	zram->stats.pages_stored--;
+	zram_pool_free(zram, entry->page, entry->offset, entry->size);
+
+out:
+	entry->page = NULL;
+	entry->offset = 0;
+	entry->size = 0;
+	entry->flags = 0;
+}
+
+static int page_zero_filled(void *ptr)
+{
+	unsigned long *page = ptr;
+	unsigned int pos;
+
+	for (pos = 0; pos < PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos])
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * I/O
+ */
+
+static int zram_read(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_table_entry *entry;
+	unsigned char *user_mem, *cmem;
+	size_t clen = PAGE_SIZE;
+	int ret = 0;
+
+	user_mem = kmap_atomic(page, KM_USER0);
+
+	spin_lock(&zram->pool_lock);
+	zram->stats.num_reads++;
+	entry = &zram->table[index];
+
+	/* Never written, or all zeroes */
+	if (zram_test_flag(zram, index, ZRAM_ZERO) || !entry->page) {
+		memset(user_mem, 0, PAGE_SIZE);
+		goto out;
+	}
+
+	cmem = page_address(entry->page);
+	if (zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
+		memcpy(user_mem, cmem, PAGE_SIZE);
+		goto out;
+	}
+
+	ret = lzo1x_decompress_safe(cmem + entry->offset, entry->size,
+				user_mem, &clen);
+	if (unlikely(ret != LZO_E_OK || clen != PAGE_SIZE)) {
+		printk(KERN_ERR "zram%d: decompression failed, block %u "
+			"err %d len %zu\n", zram->number, index, ret, clen);
+		zram->stats.invalid_io++;
+		ret = -EIO;
+	}
+
+out:
+	spin_unlock(&zram->pool_lock);
+	kunmap_atomic(user_mem, KM_USER0);
+	flush_dcache_page(page);
+
+	return ret;
+}
+
+static int zram_write(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+	unsigned char *user_mem, *src, *dst;
+	struct page *store;
+	size_t clen;
+	u16 offset = 0;
+	int ret;
+
+	mutex_lock(&zram->lock);
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	if (page_zero_filled(user_mem)) {
+		kunmap_atomic(user_mem, KM_USER0);
+		spin_lock(&zram->pool_lock);
+		zram->stats.num_writes++;
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_ZERO);
+		zram->stats.zero_pages++;
+		spin_unlock(&zram->pool_lock);
+		mutex_unlock(&zram->lock);
+		return 0;
+	}
+
+	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, zram->compress_buffer,
+				&clen, zram->compress_workmem);
+	kunmap_atomic(user_mem, KM_USER0);
+
+	if (unlikely(ret != LZO_E_OK)) {
+		printk(KERN_ERR "zram%d: compression failed, block %u "
+			"err %d\n", zram->number, index, ret);
+		ret = -EIO;
+		goto out;
+	}
+
+	if (unlikely(clen > ZRAM_MAX_ZPAGE_SIZE)) {
+		store = alloc_page(GFP_NOIO | __GFP_NOWARN);
+		if (!store) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		user_mem = kmap_atomic(page, KM_USER0);
+		memcpy(page_address(store), user_mem, PAGE_SIZE);
+		kunmap_atomic(user_mem, KM_USER0);
+
+		spin_lock(&zram->pool_lock);
+		zram_free_page(zram, index);
+		entry->page = store;
+		entry->size = PAGE_SIZE;
+		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
+		zram->stats.pages_expand++;
+		goto out_stats;
+	}
+
+	/*
+	 * Store the new object before freeing the old one: allocating may
+	 * drop pool_lock, and a read meanwhile must still find the old data.
+	 */
+	spin_lock(&zram->pool_lock);
+	ret = zram_pool_alloc(zram, clen, &store, &offset);
+	if (ret) {
+		spin_unlock(&zram->pool_lock);
+		goto out;
+	}
+
+	src = zram->compress_buffer;
+	dst = page_address(store) + offset;
+	memcpy(dst, src, clen);
+
+	zram_free_page(zram, index);
+	entry->page = store;
+	entry->offset = offset;
+	entry->size = clen;
+	zram->stats.compr_size += clen;
+	zram->stats.pages_stored++;
+	if (clen <= PAGE_SIZE / 4)
+		zram->stats.good_compress++;
+
+out_stats:
+	zram->stats.num_writes++;
+	spin_unlock(&zram->pool_lock);
+out:
+	if (ret) {
+		spin_lock(&zram->pool_lock);
+		zram->stats.invalid_io++;
+		spin_unlock(&zram->pool_lock);
+	}
+	mutex_unlock(&zram->lock);
+
+	return ret;
+}
+
+static int zram_make_request(struct request_queue *q, struct bio *bio)
+{
+	struct zram *zram = q->queuedata;
+	struct bio_vec *bvec;
+	sector_t sector;
+	u32 index;
+	int i, err = -EIO;
+
+	if (unlikely(!zram->init_done))
+		goto out;
+
+	sector = bio->bi_sector;
+	if (unlikely(sector & (PAGE_SECTORS - 1)) ||
+	    unlikely((bio->bi_size & (PAGE_SIZE - 1))) ||
+	    unlikely(((u64)sector << SECTOR_SHIFT) + bio->bi_size >
+		     zram->disksize)) {
+		spin_lock(&zram->pool_lock);
+		zram->stats.invalid_io++;
+		spin_unlock(&zram->pool_lock);
+		goto out;
+	}
+
+	index = sector >> PAGE_SECTORS_SHIFT;
+	err = 0;
+	bio_for_each_segment(bvec, bio, i) {
+		/*
+		 * Logical block size is PAGE_SIZE, so every segment is a
+		 * full page at offset 0.
+		 */
+		if (unlikely(bvec->bv_len != PAGE_SIZE || bvec->bv_offset)) {
+			err = -EIO;
+			break;
+		}
+
+		if (bio_data_dir(bio) == WRITE)
+			err = zram_write(zram, bvec->bv_page, index);
+		else
+			err = zram_read(zram, bvec->bv_page, index);
+		if (err)
+			break;
+		index++;
+	}
+
+out:
+	bio_endio(bio, err);
+
+	return 0;
+}
+
+static void zram_slot_free_notify(struct block_device *bdev,
+				unsigned long index)
+{
+	struct zram *zram = bdev->bd_disk->private_data;
+
+	spin_lock(&zram->pool_lock);
+	if (zram->init_done) {
+		zram_free_page(zram, index);
+		zram->stats.notify_free++;
+	}
+	spin_unlock(&zram->pool_lock);
+}
+
+static const struct block_device_operations zram_fops = {
+	.owner =		THIS_MODULE,
+	.swap_slot_free_notify = zram_slot_free_notify,
+};
+
+/*
+ * Setup and teardown
+ */
+
+static void zram_reset_device(struct zram *zram)
+{
+	size_t index, num_pages;
+
+	if (!zram->init_done)
+		return;
+
+	spin_lock(&zram->pool_lock);
+	zram->init_done = 0;
+	spin_unlock(&zram->pool_lock);
+
+	num_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < num_pages; index++)
+		zram_free_page(zram, index);
+
+	vfree(zram->table);
+	zram->table = NULL;
+	free_pages((unsigned long)zram->compress_buffer, 1);
+	zram->compress_buffer = NULL;
+	kfree(zram->compress_workmem);
+	zram->compress_workmem = NULL;
+
+	memset(&zram->stats, 0, sizeof(zram->stats));
+	zram->disksize = 0;
+	set_capacity(zram->disk, 0);
+}
+
+static int zram_init_device(struct zram *zram, u64 disksize)
+{
+	size_t num_pages;
+	int i;
+
+	disksize = PAGE_ALIGN(disksize);
+	num_pages = disksize >> PAGE_SHIFT;
+	if (!num_pages)
+		return -EINVAL;
+
+	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	if (!zram->compress_workmem)
+		goto fail;
+
+	/* lzo1x_worst_compress(PAGE_SIZE) does not fit in a single page */
+	zram->compress_buffer = (void *)__get_free_pages(GFP_KERNEL, 1);
+	if (!zram->compress_buffer)
+		goto fail;
+
+	zram->table = vmalloc(num_pages * sizeof(*zram->table));
+	if (!zram->table)
+		goto fail;
+	memset(zram->table, 0, num_pages * sizeof(*zram->table));
+
+	for (i = 0; i < ZRAM_NR_CLASSES; i++)
+		INIT_LIST_HEAD(&zram->classes[i].partial);
+	memset(&zram->stats, 0, sizeof(zram->stats));
+
+	zram->disksize = disksize;
+	set_capacity(zram->disk, disksize >> SECTOR_SHIFT);
+
+	spin_lock(&zram->pool_lock);
+	zram->init_done = 1;
+	spin_unlock(&zram->pool_lock);
+
+	printk(KERN_INFO "zram%d: initialized, %llu kbytes\n",
+		zram->number, (unsigned long long)disksize >> 10);
+	return 0;
+
+fail:
+	vfree(zram->table);
+	zram->table = NULL;
+	free_pages((unsigned long)zram->compress_buffer, 1);
+	zram->compress_buffer = NULL;
+	kfree(zram->compress_workmem);
+	zram->compress_workmem = NULL;
+	printk(KERN_ERR "zram%d: out of memory setting up %llu kbytes\n",
+		zram->number, (unsigned long long)disksize >> 10);
+	return -ENOMEM;
+}
+
+/*
+ * sysfs interface, in /sys/block/zramN/
+ */
+
+static inline struct zram *dev_to_zram(struct device *dev)
+{
+	return dev_to_disk(dev)->private_data;
+}
+
+static ssize_t disksize_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		(unsigned long long)dev_to_zram(dev)->disksize);
+}
+
+static ssize_t disksize_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long long disksize;
+	int ret;
+
+	if (strict_strtoull(buf, 10, &disksize))
+		return -EINVAL;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done) {
+		mutex_unlock(&zram->init_lock);
+		printk(KERN_INFO "zram%d: reset the device before "
+			"changing its size\n", zram->number);
+		return -EBUSY;
+	}
+	ret = zram_init_device(zram, disksize);
+	mutex_unlock(&zram->init_lock);
+
+	return ret ? ret : len;
+}
+
+static ssize_t initstate_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", dev_to_zram(dev)->init_done);
+}
+
+static ssize_t reset_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct block_device *bdev;
+	unsigned long do_reset;
+	int ret = len;
+
+	if (strict_strtoul(buf, 10, &do_reset))
+		return -EINVAL;
+	if (!do_reset)
+		return len;
+
+	bdev = bdget_disk(zram->disk, 0);
+	if (!bdev)
+		return -ENOMEM;
+
+	mutex_lock(&bdev->bd_mutex);
+	if (bdev->bd_openers) {
+		ret = -EBUSY;
+	} else {
+		invalidate_bh_lrus();
+		truncate_inode_pages(bdev->bd_inode->i_mapping, 0);
+		mutex_lock(&zram->init_lock);
+		zram_reset_device(zram);
+		mutex_unlock(&zram->init_lock);
+	}
+	mutex_unlock(&bdev->bd_mutex);
+	bdput(bdev);
+
+	return ret;
+}
+
+#define ZRAM_STAT_ATTR(name, expr)					\
+static ssize_t name##_show(struct device *dev,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct zram *zram = dev_to_zram(dev);				\
+	unsigned long long val;						\
+									\
+	spin_lock(&zram->pool_lock);					\
+	val = (expr);							\
+	spin_unlock(&zram->pool_lock);					\
+	return sprintf(buf, "%llu\n", val);				\
+}									\
+static DEVICE_ATTR(name, S_IRUGO, name##_show, NULL)
+
+ZRAM_STAT_ATTR(num_reads, zram->stats.num_reads);
+ZRAM_STAT_ATTR(num_writes, zram->stats.num_writes);
+ZRAM_STAT_ATTR(invalid_io, zram->stats.invalid_io);
+ZRAM_STAT_ATTR(notify_free, zram->stats.notify_free);
+ZRAM_STAT_ATTR(zero_pages, zram->stats.zero_pages);
+ZRAM_STAT_ATTR(good_compress, zram->stats.good_compress);
+ZRAM_STAT_ATTR(pages_expand, zram->stats.pages_expand);
+ZRAM_STAT_ATTR(orig_data_size,
+	(u64)(zram->stats.pages_stored + zram->stats.pages_expand)
+		<< PAGE_SHIFT);
+ZRAM_STAT_ATTR(compr_data_size,
+	zram->stats.compr_size +
+	((u64)zram->stats.pages_expand << PAGE_SHIFT));
+ZRAM_STAT_ATTR(mem_used_total,
+	(u64)(zram->stats.pool_pages + zram->stats.pages_expand)
+		<< PAGE_SHIFT);
+
+/*
+ * Stored data over memory used, in hundredths: 300 means the pages kept
+ * by the device take a third of the RAM they would take uncompressed.
+ * Zero pages are not counted on either side.
+ */
+static ssize_t compr_ratio_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 orig, used;
+
+	spin_lock(&zram->pool_lock);
+	orig = (u64)(zram->stats.pages_stored + zram->stats.pages_expand)
+		<< PAGE_SHIFT;
+	used = (u64)(zram->stats.pool_pages + zram->stats.pages_expand)
+		<< PAGE_SHIFT;
+	spin_unlock(&zram->pool_lock);
+
+	if (!used)
+		return sprintf(buf, "0\n");
+	return sprintf(buf, "%llu\n",
+		(unsigned long long)div64_u64(orig * 100, used));
+}
+
+static DEVICE_ATTR(disksize, S_IRUGO | S_IWUSR,
+		disksize_show, disksize_store);
+static DEVICE_ATTR(initstate, S_IRUGO, initstate_show, NULL);
+static DEVICE_ATTR(reset, S_IWUSR, NULL, reset_store);
+static DEVICE_ATTR(compr_ratio, S_IRUGO, compr_ratio_show, NULL);
+
+static struct attribute *zram_disk_attrs[] = {
+	&dev_attr_disksize.attr,
+	&dev_attr_initstate.attr,
+	&dev_attr_reset.attr,
+	&dev_attr_num_reads.attr,
+	&dev_attr_num_writes.attr,
+	&dev_attr_invalid_io.attr,
+	&dev_attr_notify_free.attr,
+	&dev_attr_zero_pages.attr,
+	&dev_attr_good_compress.attr,
+	&dev_attr_pages_expand.attr,
+	&dev_attr_orig_data_size.attr,
+	&dev_attr_compr_data_size.attr,
+	&dev_attr_mem_used_total.attr,
+	&dev_attr_compr_ratio.attr,
+	NULL,
+};
+
+static struct attribute_group zram_disk_attr_group = {
+	.attrs = zram_disk_attrs,
+};
+
+static int zram_create_device(struct zram *zram, int device_id)
+{
+	zram->number = device_id;
+	mutex_init(&zram->init_lock);
+	mutex_init(&zram->lock);
+	spin_lock_init(&zram->pool_lock);
+
+	zram->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!zram->queue)
+		goto out;
+	blk_queue_make_request(zram->queue, zram_make_request);
+	zram->queue->queuedata = zram;
+	blk_queue_logical_block_size(zram->queue, PAGE_SIZE);
+	blk_queue_physical_block_size(zram->queue, PAGE_SIZE);
+	blk_queue_bounce_limit(zram->queue, BLK_BOUNCE_ANY);
+	/* No seeks: lets swap spread out its allocations */
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->queue);
+
+	zram->disk = alloc_disk(1);
+	if (!zram->disk)
+		goto out_free_queue;
+	zram->disk->major = zram_major;
+	zram->disk->first_minor = device_id;
+	zram->disk->fops = &zram_fops;
+	zram->disk->queue = zram->queue;
+	zram->disk->private_data = zram;
+	snprintf(zram->disk->disk_name, 16, "zram%d", device_id);
+
+	/* Capacity is set once the size is known */
+	set_capacity(zram->disk, 0);
+	add_disk(zram->disk);
+
+	if (sysfs_create_group(&disk_to_dev(zram->disk)->kobj,
+				&zram_disk_attr_group))
+		printk(KERN_WARNING "zram%d: cannot create sysfs attributes\n",
+			device_id);
+
+	if (disksize_kb)
+		zram_init_device(zram, (u64)disksize_kb << 10);
+
+	return 0;
+
+out_free_queue:
+	blk_cleanup_queue(zram->queue);
+out:
+	return -ENOMEM;
+}
+
+static void zram_destroy_device(struct zram *zram)
+{
+	zram_reset_device(zram);
+	sysfs_remove_group(&disk_to_dev(zram->disk)->kobj,
+			&zram_disk_attr_group);
+	del_gendisk(zram->disk);
+	put_disk(zram->disk);
+	blk_cleanup_queue(zram->queue);
+}
+
+static int __init zram_init(void)
+{
+	int i, ret;
+
+	if (!num_devices || num_devices > 32) {
+		printk(KERN_ERR "zram: invalid num_devices %u\n", num_devices);
+		return -EINVAL;
+	}
+
+	zram_major = register_blkdev(0, "zram");
+	if (zram_major <= 0)
+		return -EBUSY;
+
+	zram_devices = kzalloc(num_devices * sizeof(*zram_devices),
+				GFP_KERNEL);
+	if (!zram_devices) {
+		ret = -ENOMEM;
+		goto out_unregister;
+	}
+
+	for (i = 0; i < num_devices; i++) {
+		ret = zram_create_device(&zram_devices[i], i);
+		if (ret)
+			goto out_free;
+	}
+
+	printk(KERN_INFO "zram: created %u device(s)\n", num_devices);
+	return 0;
+
+out_free:
+	while (--i >= 0)
+		zram_destroy_device(&zram_devices[i]);
+	kfree(zram_devices);
+out_unregister:
+	unregister_blkdev(zram_major, "zram");
+	return ret;
+}
+
+static void __exit zram_exit(void)
+{
+	int i;
+
+	for (i = 0; i < num_devices; i++)
+		zram_destroy_device(&zram_devices[i]);
+
+	kfree(zram_devices);
+	unregister_blkdev(zram_major, "zram");
+}
+
+module_init(zram_init);
+module_exit(zram_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compressed RAM block device");
@@ -0,0 +1,417 @@
+/*
+ *  drivers/cpufreq/cpufreq_input_boost.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Raise the cpufreq floor on user input.
+ *
+ * Touch and key events arrive while the CPU may still be at its lowest
+ * speed, and the first frames drawn in response are slow until the
+ * governor notices the load. This handler raises the minimum speed of
+ * every policy to boost_freq as soon as an event comes in, and drops it
+ * again boost_ms after the last accepted event. The floor is applied
+ * through a policy notifier, so whichever governor is running sees a
+ * normal limits change and the driver (acpuclock on MSM) switches
+ * speed right away.
+ *
+ * Boosts are rate limited to one every min_interval_ms; events in
+ * between only count as suppressed. Each input device can be enabled or
+ * disabled through sysfs.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#define DEFAULT_BOOST_MS		500
+#define DEFAULT_MIN_INTERVAL_MS		100
+
+struct input_boost_handle {
+	struct input_handle handle;
+	struct list_head list;
+	int enabled;
+};
+
+static LIST_HEAD(boost_handles);
+static DEFINE_MUTEX(boost_handles_lock);
+
+static struct workqueue_struct *boost_wq;
+static struct work_struct boost_start_work;
+static struct delayed_work boost_end_work;
+
+/* Tunables. A boost_freq of 0 boosts to the policy maximum. */
+static unsigned int boost_freq;
+static unsigned int boost_ms = DEFAULT_BOOST_MS;
+static unsigned int min_interval_ms = DEFAULT_MIN_INTERVAL_MS;
+
+/* Written from the boost work only */
+static int boost_active;
+
+/* Rate limiting of boosts, from the input event path */
+static DEFINE_SPINLOCK(boost_lock);
+static unsigned long last_boost;
+static int boosted;		/* last_boost is valid */
+static atomic_t boost_count = ATOMIC_INIT(0);
+static atomic_t suppressed_count = ATOMIC_INIT(0);
+
+static void input_boost_update_policies(void)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+static int input_boost_notifier(struct notifier_block *nb,
+				unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int freq;
+
+	if (val != CPUFREQ_ADJUST || !boost_active)
+		return NOTIFY_OK;
+
+	freq = boost_freq ? boost_freq : policy->cpuinfo.max_freq;
+	freq = min(freq, policy->max);
+	cpufreq_verify_within_limits(policy, freq, policy->max);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block input_boost_nb = {
+	.notifier_call = input_boost_notifier,
+};
+
+static void input_boost_start(struct work_struct *work)
+{
+	/*
+	 * The end work may already sit on the queue behind us, where
+	 * cancel_delayed_work() would miss it and the requeue below would
+	 * be a no-op. Both run on boost_wq, so it cannot be running now.
+	 */
+	cancel_delayed_work_sync(&boost_end_work);
+
+	if (!boost_active) {
+		boost_active = 1;
+		input_boost_update_policies();
+	}
+
+	queue_delayed_work(boost_wq, &boost_end_work,
+			   msecs_to_jiffies(boost_ms));
+}
+
+static void input_boost_end(struct work_struct *work)
+{
+	boost_active = 0;
+	input_boost_update_policies();
+}
+
+static void input_boost_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	struct input_boost_handle *bh = handle->private;
+	unsigned long now = jiffies;
+	unsigned long flags;
+
+	if (!bh->enabled)
+		return;
+
+	/* Key releases and sync/misc events do not start any work */
+	if (type == EV_KEY) {
+		if (!value)
+			return;
+	} else if (type != EV_ABS) {
+		return;
+	}
+
+	spin_lock_irqsave(&boost_lock, flags);
+	if (boosted &&
+	    time_before(now, last_boost + msecs_to_jiffies(min_interval_ms))) {
+		spin_unlock_irqrestore(&boost_lock, flags);
+		atomic_inc(&suppressed_count);
+		return;
+	}
+	boosted = 1;
+	last_boost = now;
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	atomic_inc(&boost_count);
+	queue_work(boost_wq, &boost_start_work);
+}
+
+static int input_boost_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_boost_handle *bh;
+	int error;
+
+	bh = kzalloc(sizeof(*bh), GFP_KERNEL);
+	if (!bh)
+		return -ENOMEM;
+
+	bh->enabled = 1;
+	bh->handle.dev = dev;
+	bh->handle.handler = handler;
+	bh->handle.name = "cpufreq_input_boost";
+	bh->handle.private = bh;
+
+	error = input_register_handle(&bh->handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(&bh->handle);
+	if (error)
+		goto err1;
+
+	mutex_lock(&boost_handles_lock);
+	list_add_tail(&bh->list, &boost_handles);
+	mutex_unlock(&boost_handles_lock);
+
+	return 0;
+err1:
+	input_unregister_handle(&bh->handle);
+err2:
+	kfree(bh);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	struct input_boost_handle *bh = handle->private;
+
+	mutex_lock(&boost_handles_lock);
+	list_del(&bh->list);
+	mutex_unlock(&boost_handles_lock);
+
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(bh);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	/* multi-touch touchscreens */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	/* single-touch touchscreens */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	/* keypads and buttons; motion sensors report EV_ABS only */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_input_boost",
+	.id_table	= input_boost_ids,
+};
+
+/************************** sysfs interface ************************/
+
+#define show_one(file_name)						\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%u\n", file_name);				\
+}
+
+#define store_one(file_name)						\
+static ssize_t store_##file_name					\
+(struct kobject *kobj, struct attribute *attr, const char *buf,		\
+ size_t count)								\
+{									\
+	unsigned long val;						\
+									\
+	if (strict_strtoul(buf, 0, &val))				\
+		return -EINVAL;						\
+	file_name = val;						\
+	return count;							\
+}
+
+show_one(boost_freq);
+store_one(boost_freq);
+show_one(boost_ms);
+store_one(boost_ms);
+show_one(min_interval_ms);
+store_one(min_interval_ms);
+
+static ssize_t show_boost_count(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", atomic_read(&boost_count));
+}
+
+static ssize_t show_suppressed_count(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", atomic_read(&suppressed_count));
+}
+
+/*
+ * One line per connected device, "<enabled> <name>". Write the same
+ * format to enable or disable boosting for a device.
+ */
+static ssize_t show_devices(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	struct input_boost_handle *bh;
+	ssize_t len = 0;
+
+	mutex_lock(&boost_handles_lock);
+	list_for_each_entry(bh, &boost_handles, list) {
+		len += snprintf(buf + len, PAGE_SIZE - len, "%d %s\n",
+				bh->enabled,
+				bh->handle.dev->name ? bh->handle.dev->name : "");
+		if (len >= PAGE_SIZE)
+			break;
+	}
+	mutex_unlock(&boost_handles_lock);
+
+	return min_t(ssize_t, len, PAGE_SIZE);
+}
+
+static ssize_t store_devices(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	struct input_boost_handle *bh;
+	const char *name;
+	size_t len;
+	int enable, found = 0;
+
+	if (count < 3 || (buf[0] != '0' && buf[0] != '1') || buf[1] != ' ')
+		return -EINVAL;
+	enable = buf[0] - '0';
+	name = buf + 2;
+	len = strcspn(name, "\n");
+
+	mutex_lock(&boost_handles_lock);
+	list_for_each_entry(bh, &boost_handles, list) {
+		const char *dev_name = bh->handle.dev->name;
+
+		if (dev_name && strlen(dev_name) == len &&
+		    !strncmp(dev_name, name, len)) {
+			bh->enabled = enable;
+			found = 1;
+		}
+	}
+	mutex_unlock(&boost_handles_lock);
+
+	return found ? count : -ENODEV;
+}
+
+#define define_one_rw(_name)				\
+static struct global_attr _name##_attr =		\
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+#define define_one_ro(_name)				\
+static struct global_attr _name##_attr =		\
+__ATTR(_name, 0444, show_##_name, NULL)
+
+define_one_rw(boost_freq);
+define_one_rw(boost_ms);
+define_one_rw(min_interval_ms);
+define_one_rw(devices);
+define_one_ro(boost_count);
+define_one_ro(suppressed_count);
+
+static struct attribute *input_boost_attributes[] = {
+	&boost_freq_attr.attr,
+	&boost_ms_attr.attr,
+	&min_interval_ms_attr.attr,
+	&devices_attr.attr,
+	&boost_count_attr.attr,
+	&suppressed_count_attr.attr,
+	NULL,
+};
+
+static struct attribute_group input_boost_attr_group = {
+	.attrs = input_boost_attributes,
+	.name = "input_boost",
+};
+
+/************************** sysfs end ************************/
+
+static int __init cpufreq_input_boost_init(void)
+{
+	int ret;
+
+	boost_wq = create_singlethread_workqueue("cpufreq_input_boost");
+	if (!boost_wq)
+		return -ENOMEM;
+
+	INIT_WORK(&boost_start_work, input_boost_start);
+	INIT_DELAYED_WORK(&boost_end_work, input_boost_end);
+
+	ret = cpufreq_register_notifier(&input_boost_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		goto err_wq;
+
+	ret = sysfs_create_group(cpufreq_global_kobject,
+				 &input_boost_attr_group);
+	if (ret)
+		goto err_notifier;
+
+	ret = input_register_handler(&input_boost_handler);
+	if (ret)
+		goto err_sysfs;
+
+	return 0;
+
+err_sysfs:
+	sysfs_remove_group(cpufreq_global_kobject, &input_boost_attr_group);
+err_notifier:
+	cpufreq_unregister_notifier(&input_boost_nb, CPUFREQ_POLICY_NOTIFIER);
+err_wq:
+	destroy_workqueue(boost_wq);
+	return ret;
+}
+
+static void __exit cpufreq_input_boost_exit(void)
+{
+	input_unregister_handler(&input_boost_handler);
+	sysfs_remove_group(cpufreq_global_kobject, &input_boost_attr_group);
+
+	cancel_work_sync(&boost_start_work);
+	cancel_delayed_work_sync(&boost_end_work);
+	cpufreq_unregister_notifier(&input_boost_nb, CPUFREQ_POLICY_NOTIFIER);
+	destroy_workqueue(boost_wq);
+
+	if (boost_active) {
+		boost_active = 0;
+		input_boost_update_policies();
+	}
+}
+
+late_initcall(cpufreq_input_boost_init);
+module_exit(cpufreq_input_boost_exit);
+
+MODULE_DESCRIPTION("Raise the cpufreq minimum on input events");
+MODULE_LICENSE("GPL");
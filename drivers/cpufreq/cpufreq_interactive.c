@@ -0,0 +1,626 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * 'interactive' - a latency driven cpufreq governor.
+ *
+ * Load is sampled per CPU over a window that starts when the CPU leaves
+ * idle, instead of on a fixed polling grid. When the load of the current
+ * window reaches go_hispeed_load, the CPU is sent straight to
+ * hispeed_freq (and on to the maximum if it stays loaded). The check is
+ * done from the idle exit path as well as from the sampling timer, so a
+ * burst of work is caught within a few milliseconds even with HZ=100.
+ * Speed is only lowered once it has been held for min_sample_time.
+ *
+ * Speed increases are applied by a realtime kthread, decreases from a
+ * workqueue.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/spinlock.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_interactive.h>
+
+/* Go to hispeed_freq when load is at or above this value */
+#define DEFAULT_GO_HISPEED_LOAD		85
+
+/* Minimum time (uS) to hold a speed before ramping down */
+#define DEFAULT_MIN_SAMPLE_TIME		(80 * USEC_PER_MSEC)
+
+/* Sampling interval (uS) */
+#define DEFAULT_TIMER_RATE		(20 * USEC_PER_MSEC)
+
+static void (*pm_idle_old)(void);
+static atomic_t active_count = ATOMIC_INIT(0);
+
+struct cpufreq_interactive_cpuinfo {
+	struct timer_list cpu_timer;
+	int timer_idlecancel;
+	int idling;
+	/* Start of the current sample window, and idle time at that point */
+	u64 idle_exit_time;
+	u64 time_in_idle;
+	/* Last time the CPU left idle to run something */
+	u64 busy_start;
+	/* When the speed was last changed, and when the pending raise began */
+	u64 freq_change_time;
+	u64 ramp_start;
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int target_freq;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
+
+/* Realtime thread handles frequency scaling up */
+static struct task_struct *up_task;
+static cpumask_t up_cpumask;
+static DEFINE_SPINLOCK(up_cpumask_lock);
+
+/* Workqueue handles frequency scaling down */
+static struct workqueue_struct *down_wq;
+static struct work_struct freq_scale_down_work;
+static cpumask_t down_cpumask;
+static DEFINE_SPINLOCK(down_cpumask_lock);
+
+/* Serialises speed changes of CPUs sharing a policy */
+static DEFINE_MUTEX(set_speed_lock);
+
+/* Tunables, all times in uS */
+static unsigned long hispeed_freq;
+static unsigned long go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
+static unsigned long min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
+static unsigned long timer_rate = DEFAULT_TIMER_RATE;
+
+/* Time from the start of a busy period to reaching the raised speed */
+static struct {
+	unsigned long count;
+	unsigned long total_us;
+	unsigned long max_us;
+} ramp_stats;
+static DEFINE_SPINLOCK(ramp_stats_lock);
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name = "interactive",
+	.governor = cpufreq_governor_interactive,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+static void cpufreq_interactive_arm_timer(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu,
+	int idlecancel)
+{
+	pcpu->time_in_idle = get_cpu_idle_time_us(cpu, &pcpu->idle_exit_time);
+	pcpu->timer_idlecancel = idlecancel;
+	mod_timer_pinned(&pcpu->cpu_timer,
+			 jiffies + usecs_to_jiffies(timer_rate));
+}
+
+/*
+ * Work out the speed the load of the current window asks for and hand
+ * it to the up or down path. From idle exit only increases are acted on;
+ * the window is still being filled.
+ */
+static void cpufreq_interactive_evaluate(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu,
+	u64 now, u64 now_idle, int idle_exit)
+{
+	struct cpufreq_policy *policy = pcpu->policy;
+	unsigned int delta_idle, delta_time;
+	unsigned int cpu_load, new_freq, index;
+	unsigned long flags;
+
+	delta_idle = (unsigned int)(now_idle - pcpu->time_in_idle);
+	delta_time = (unsigned int)(now - pcpu->idle_exit_time);
+	if (!delta_time)
+		return;
+
+	if (delta_idle > delta_time)
+		cpu_load = 0;
+	else
+		cpu_load = 100 * (delta_time - delta_idle) / delta_time;
+
+	if (cpu_load >= go_hispeed_load) {
+		if (pcpu->target_freq < hispeed_freq)
+			new_freq = hispeed_freq;
+		else
+			new_freq = policy->max;
+	} else {
+		if (idle_exit)
+			return;
+		new_freq = policy->max * cpu_load / 100;
+	}
+
+	if (cpufreq_frequency_table_target(policy, pcpu->freq_table, new_freq,
+					   CPUFREQ_RELATION_H, &index))
+		return;
+	new_freq = pcpu->freq_table[index].frequency;
+
+	trace_cpufreq_interactive_target(cpu, cpu_load, pcpu->target_freq,
+					 new_freq, idle_exit);
+
+	if (new_freq == pcpu->target_freq)
+		return;
+
+	/* Hold the current speed for at least min_sample_time */
+	if (new_freq < pcpu->target_freq &&
+	    now - pcpu->freq_change_time < min_sample_time) {
+		trace_cpufreq_interactive_notyet(cpu, cpu_load,
+						 pcpu->target_freq, new_freq);
+		return;
+	}
+
+	pcpu->target_freq = new_freq;
+
+	if (new_freq > policy->cur) {
+		pcpu->ramp_start = max(pcpu->busy_start, pcpu->idle_exit_time);
+		spin_lock_irqsave(&up_cpumask_lock, flags);
+		cpumask_set_cpu(cpu, &up_cpumask);
+		spin_unlock_irqrestore(&up_cpumask_lock, flags);
+		wake_up_process(up_task);
+	} else {
+		spin_lock_irqsave(&down_cpumask_lock, flags);
+		cpumask_set_cpu(cpu, &down_cpumask);
+		spin_unlock_irqrestore(&down_cpumask_lock, flags);
+		queue_work(down_wq, &freq_scale_down_work);
+	}
+}
+
+static void cpufreq_interactive_timer(unsigned long data)
+{
+	unsigned int cpu = data;
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	u64 now, now_idle;
+
+	smp_rmb();
+	if (!pcpu->governor_enabled)
+		return;
+
+	now_idle = get_cpu_idle_time_us(cpu, &now);
+	cpufreq_interactive_evaluate(pcpu, cpu, now, now_idle, 0);
+
+	/*
+	 * Idle at minimum speed: there is nothing to sample until the CPU
+	 * has work again, and idle exit re-arms the timer then.
+	 */
+	if (pcpu->idling && pcpu->target_freq == pcpu->policy->min)
+		return;
+
+	/*
+	 * At minimum speed the next sample only matters if the CPU stays
+	 * busy, so let idle entry cancel it.
+	 */
+	cpufreq_interactive_arm_timer(pcpu, cpu,
+			pcpu->target_freq == pcpu->policy->min);
+}
+
+static void cpufreq_interactive_idle_exit(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int cpu)
+{
+	unsigned long flags;
+	u64 now, now_idle;
+
+	/* Keep the sampling timer, which runs on this CPU, out */
+	local_irq_save(flags);
+
+	now_idle = get_cpu_idle_time_us(cpu, &now);
+	pcpu->busy_start = now;
+
+	if (!timer_pending(&pcpu->cpu_timer)) {
+		cpufreq_interactive_arm_timer(pcpu, cpu, 0);
+	} else if (pcpu->target_freq < hispeed_freq &&
+		   now - pcpu->idle_exit_time >= timer_rate / 4) {
+		/*
+		 * Enough of the window has gone by to judge it: catch a
+		 * load spike now rather than at the next timer tick.
+		 */
+		cpufreq_interactive_evaluate(pcpu, cpu, now, now_idle, 1);
+	}
+
+	local_irq_restore(flags);
+}
+
+static void cpufreq_interactive_idle(void)
+{
+	unsigned int cpu = smp_processor_id();
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	int pending;
+
+	if (!pcpu->governor_enabled) {
+		pm_idle_old();
+		return;
+	}
+
+	pcpu->idling = 1;
+	smp_wmb();
+	pending = timer_pending(&pcpu->cpu_timer);
+
+	if (pcpu->target_freq != pcpu->policy->min) {
+		/*
+		 * Keep sampling while idle above minimum speed, so that an
+		 * idle CPU does not hold the speed up indefinitely.
+		 */
+		if (!pending)
+			cpufreq_interactive_arm_timer(pcpu, cpu, 0);
+	} else if (pending && pcpu->timer_idlecancel) {
+		/*
+		 * At minimum speed and the CPU did not stay busy; the
+		 * timer set in case it did is not needed.
+		 */
+		del_timer(&pcpu->cpu_timer);
+	}
+
+	pm_idle_old();
+
+	pcpu->idling = 0;
+	smp_wmb();
+
+	/* Only a wakeup that has work to run starts a busy period */
+	if (need_resched())
+		cpufreq_interactive_idle_exit(pcpu, cpu);
+}
+
+static void cpufreq_interactive_ramp_account(unsigned int us)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ramp_stats_lock, flags);
+	ramp_stats.count++;
+	ramp_stats.total_us += us;
+	if (us > ramp_stats.max_us)
+		ramp_stats.max_us = us;
+	spin_unlock_irqrestore(&ramp_stats_lock, flags);
+}
+
+static void cpufreq_interactive_set_speed(unsigned int cpu, int up)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	unsigned int j, max_freq = 0;
+	unsigned int ramp_us;
+
+	smp_rmb();
+	if (!pcpu->governor_enabled)
+		return;
+
+	mutex_lock(&set_speed_lock);
+
+	/* The policy runs at the highest speed any of its CPUs wants */
+	for_each_cpu(j, pcpu->policy->cpus) {
+		struct cpufreq_interactive_cpuinfo *pjcpu =
+			&per_cpu(cpuinfo, j);
+
+		if (pjcpu->target_freq > max_freq)
+			max_freq = pjcpu->target_freq;
+	}
+
+	if (max_freq != pcpu->policy->cur)
+		__cpufreq_driver_target(pcpu->policy, max_freq,
+					CPUFREQ_RELATION_H);
+
+	get_cpu_idle_time_us(cpu, &pcpu->freq_change_time);
+
+	if (up) {
+		ramp_us = (unsigned int)(pcpu->freq_change_time -
+					 pcpu->ramp_start);
+		cpufreq_interactive_ramp_account(ramp_us);
+		trace_cpufreq_interactive_up(cpu, max_freq,
+					     pcpu->policy->cur, ramp_us);
+	} else {
+		trace_cpufreq_interactive_down(cpu, max_freq,
+					       pcpu->policy->cur);
+	}
+
+	mutex_unlock(&set_speed_lock);
+}
+
+static int cpufreq_interactive_up_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&up_cpumask_lock, flags);
+
+		if (cpumask_empty(&up_cpumask)) {
+			spin_unlock_irqrestore(&up_cpumask_lock, flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&up_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = up_cpumask;
+		cpumask_clear(&up_cpumask);
+		spin_unlock_irqrestore(&up_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask)
+			cpufreq_interactive_set_speed(cpu, 1);
+	}
+
+	return 0;
+}
+
+static void cpufreq_interactive_freq_down(struct work_struct *work)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+
+	spin_lock_irqsave(&down_cpumask_lock, flags);
+	tmp_mask = down_cpumask;
+	cpumask_clear(&down_cpumask);
+	spin_unlock_irqrestore(&down_cpumask_lock, flags);
+
+	for_each_cpu(cpu, &tmp_mask)
+		cpufreq_interactive_set_speed(cpu, 0);
+}
+
+/************************** sysfs interface ************************/
+
+#define show_one(file_name)						\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%lu\n", file_name);			\
+}
+
+show_one(hispeed_freq);
+show_one(go_hispeed_load);
+show_one(min_sample_time);
+show_one(timer_rate);
+
+static ssize_t store_hispeed_freq(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || !val)
+		return -EINVAL;
+	hispeed_freq = val;
+	return count;
+}
+
+static ssize_t store_go_hispeed_load(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || !val || val > 100)
+		return -EINVAL;
+	go_hispeed_load = val;
+	return count;
+}
+
+static ssize_t store_min_sample_time(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+	min_sample_time = val;
+	return count;
+}
+
+static ssize_t store_timer_rate(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+	/* Anything shorter than a tick is a tick anyway */
+	timer_rate = max(val, (unsigned long)jiffies_to_usecs(1));
+	return count;
+}
+
+static ssize_t show_ramp_stats(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	unsigned long count, total, max_us, flags;
+
+	spin_lock_irqsave(&ramp_stats_lock, flags);
+	count = ramp_stats.count;
+	total = ramp_stats.total_us;
+	max_us = ramp_stats.max_us;
+	spin_unlock_irqrestore(&ramp_stats_lock, flags);
+
+	return sprintf(buf, "count %lu avg_us %lu max_us %lu\n",
+		       count, count ? total / count : 0, max_us);
+}
+
+#define define_one_rw(_name)				\
+static struct global_attr _name##_attr =		\
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+define_one_rw(hispeed_freq);
+define_one_rw(go_hispeed_load);
+define_one_rw(min_sample_time);
+define_one_rw(timer_rate);
+
+static struct global_attr ramp_stats_attr =
+__ATTR(ramp_stats, 0444, show_ramp_stats, NULL);
+
+static struct attribute *interactive_attributes[] = {
+	&hispeed_freq_attr.attr,
+	&go_hispeed_load_attr.attr,
+	&min_sample_time_attr.attr,
+	&timer_rate_attr.attr,
+	&ramp_stats_attr.attr,
+	NULL,
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+/************************** sysfs end ************************/
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int j;
+	u64 now;
+	int rc;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		if (get_cpu_idle_time_us(policy->cpu, &now) == -1ULL) {
+			printk(KERN_ERR "cpufreq_interactive: needs "
+			       "NO_HZ idle time accounting\n");
+			return -EINVAL;
+		}
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->target_freq = policy->cur;
+			pcpu->freq_table = cpufreq_frequency_get_table(j);
+			pcpu->time_in_idle = get_cpu_idle_time_us(j,
+						&pcpu->idle_exit_time);
+			pcpu->freq_change_time = pcpu->idle_exit_time;
+			pcpu->busy_start = pcpu->idle_exit_time;
+			pcpu->timer_idlecancel = 0;
+			pcpu->cpu_timer.expires =
+				jiffies + usecs_to_jiffies(timer_rate);
+			add_timer_on(&pcpu->cpu_timer, j);
+			pcpu->governor_enabled = 1;
+			smp_wmb();
+		}
+
+		if (!hispeed_freq)
+			hispeed_freq = policy->max;
+
+		/* Do not register the sysfs group more than once */
+		if (atomic_inc_return(&active_count) > 1)
+			return 0;
+
+		rc = sysfs_create_group(cpufreq_global_kobject,
+					&interactive_attr_group);
+		if (rc) {
+			atomic_dec(&active_count);
+			return rc;
+		}
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->governor_enabled = 0;
+			smp_wmb();
+			del_timer_sync(&pcpu->cpu_timer);
+		}
+
+		flush_work(&freq_scale_down_work);
+		if (atomic_dec_return(&active_count) > 0)
+			return 0;
+
+		sysfs_remove_group(cpufreq_global_kobject,
+				   &interactive_attr_group);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy, policy->max,
+						CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy, policy->min,
+						CPUFREQ_RELATION_L);
+
+		/*
+		 * Start again from the speed actually set, so that when a
+		 * raised minimum is dropped the next sample can lower it.
+		 */
+		for_each_cpu(j, policy->cpus)
+			per_cpu(cpuinfo, j).target_freq = policy->cur;
+		mutex_unlock(&set_speed_lock);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_interactive_init(void)
+{
+	unsigned int i;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	/* Initialize per-cpu timers */
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		init_timer(&pcpu->cpu_timer);
+		pcpu->cpu_timer.function = cpufreq_interactive_timer;
+		pcpu->cpu_timer.data = i;
+	}
+
+	up_task = kthread_create(cpufreq_interactive_up_task, NULL,
+				 "kinteractiveup");
+	if (IS_ERR(up_task))
+		return PTR_ERR(up_task);
+
+	sched_setscheduler_nocheck(up_task, SCHED_FIFO, &param);
+	get_task_struct(up_task);
+
+	down_wq = create_rt_workqueue("kinteractive_down");
+	if (!down_wq)
+		goto err_freeuptask;
+
+	INIT_WORK(&freq_scale_down_work, cpufreq_interactive_freq_down);
+
+	/* Let the thread enter its loop */
+	wake_up_process(up_task);
+
+	pm_idle_old = pm_idle;
+	pm_idle = cpufreq_interactive_idle;
+
+	return cpufreq_register_governor(&cpufreq_gov_interactive);
+
+err_freeuptask:
+	kthread_stop(up_task);
+	put_task_struct(up_task);
+	return -ENOMEM;
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_interactive_init);
+#else
+module_init(cpufreq_interactive_init);
+#endif
+
+MODULE_DESCRIPTION("'cpufreq_interactive' - A cpufreq governor for "
+	"latency sensitive workloads");
+MODULE_LICENSE("GPL");
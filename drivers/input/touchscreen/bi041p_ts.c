@@ -1261,6 +1261,9 @@ static struct i2c_driver bi041p_driver = {
 	.resume		= bi041p_resume,
 	.driver = {
 		.name	= "bi041p",
+		/* probe sleeps through the chip reset; the innolux and
+		 * bu21018mwv drivers it checks probe before it, in sync */
+		.probe_async = true,
 	},
 };
 
@@ -15,6 +15,8 @@
 #include <linux/mmc/mmc.h>
 
 #include <linux/scatterlist.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
 
 #define RESULT_OK		0
 #define RESULT_FAIL		1
@@ -891,6 +893,153 @@ static int mmc_test_multi_read_high(struct mmc_test_card *test)
 
 #endif /* CONFIG_HIGHMEM */
 
+/*******************************************************************/
+/*  Request pipelining performance                                 */
+/*******************************************************************/
+
+#define MMC_TEST_PERF_COUNT	512	/* requests per run */
+#define MMC_TEST_PERF_BLOCKS	8	/* 4 KiB per request */
+
+struct mmc_test_perf_req {
+	struct mmc_async_req	areq;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct scatterlist	sg;
+	struct mmc_test_card	*test;
+};
+
+static int mmc_test_perf_err_check(struct mmc_card *card,
+	struct mmc_async_req *areq)
+{
+	struct mmc_test_perf_req *rq =
+		container_of(areq, struct mmc_test_perf_req, areq);
+
+	return mmc_test_check_result(rq->test, &rq->mrq);
+}
+
+static unsigned int mmc_test_card_sectors(struct mmc_card *card)
+{
+	if (!mmc_card_sd(card) && mmc_card_blockaddr(card))
+		return card->ext_csd.sectors;
+	return card->csd.capacity << (card->csd.read_blkbits - 9);
+}
+
+static void mmc_test_perf_prepare(struct mmc_test_card *test,
+	struct mmc_test_perf_req *rq, unsigned sector, u8 *buf)
+{
+	unsigned dev_addr = sector;
+
+	if (!mmc_card_blockaddr(test->card))
+		dev_addr <<= 9;
+
+	memset(rq, 0, sizeof(struct mmc_test_perf_req));
+	rq->mrq.cmd = &rq->cmd;
+	rq->mrq.data = &rq->data;
+	rq->mrq.stop = &rq->stop;
+	rq->areq.mrq = &rq->mrq;
+	rq->areq.err_check = mmc_test_perf_err_check;
+	rq->test = test;
+
+	sg_init_one(&rq->sg, buf, MMC_TEST_PERF_BLOCKS * 512);
+
+	mmc_test_prepare_mrq(test, &rq->mrq, &rq->sg, 1, dev_addr,
+		MMC_TEST_PERF_BLOCKS, 512, 0);
+}
+
+/*
+ * Issue MMC_TEST_PERF_COUNT 4 KiB reads, either one at a time or with
+ * the next request prepared while the previous one is transferring,
+ * and report the resulting IOPS.
+ */
+static int mmc_test_perf_read(struct mmc_test_card *test, int random,
+	int nonblock)
+{
+	struct mmc_test_perf_req rq[2];
+	struct mmc_host *host = test->card->host;
+	unsigned int sectors, sector = 0;
+	ktime_t start;
+	u64 ns;
+	int i, ret = 0;
+
+	if (host->max_blk_count < MMC_TEST_PERF_BLOCKS ||
+	    host->max_req_size < MMC_TEST_PERF_BLOCKS * 512 ||
+	    host->max_seg_size < MMC_TEST_PERF_BLOCKS * 512)
+		return RESULT_UNSUP_HOST;
+
+	sectors = mmc_test_card_sectors(test->card);
+	if (sectors < MMC_TEST_PERF_COUNT * MMC_TEST_PERF_BLOCKS)
+		return RESULT_UNSUP_CARD;
+
+	start = ktime_get();
+
+	for (i = 0;i < MMC_TEST_PERF_COUNT;i++) {
+		struct mmc_test_perf_req *cur = &rq[i & 1];
+
+		if (random)
+			sector = (random32() % (sectors /
+				MMC_TEST_PERF_BLOCKS)) * MMC_TEST_PERF_BLOCKS;
+
+		mmc_test_perf_prepare(test, cur, sector,
+			test->buffer + (i & 1) * MMC_TEST_PERF_BLOCKS * 512);
+
+		if (nonblock) {
+			mmc_start_req(host, &cur->areq, &ret);
+		} else {
+			mmc_wait_for_req(host, &cur->mrq);
+			ret = mmc_test_check_result(test, &cur->mrq);
+		}
+		if (ret)
+			break;
+
+		sector += MMC_TEST_PERF_BLOCKS;
+	}
+
+	if (nonblock && !ret)
+		mmc_start_req(host, NULL, &ret);
+	if (ret)
+		return ret;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	printk(KERN_INFO "%s: %s %s read: %u x %u bytes in %llu us, "
+		"%llu IOPS\n", mmc_hostname(host),
+		random ? "Random" : "Sequential",
+		nonblock ? "non-blocking" : "blocking",
+		MMC_TEST_PERF_COUNT, MMC_TEST_PERF_BLOCKS * 512,
+		(unsigned long long)div_u64(ns, NSEC_PER_USEC),
+		(unsigned long long)(ns ? div64_u64((u64)MMC_TEST_PERF_COUNT *
+			NSEC_PER_SEC, ns) : 0));
+
+	return 0;
+}
+
+static int mmc_test_prepare_perf(struct mmc_test_card *test)
+{
+	return mmc_test_set_blksize(test, 512);
+}
+
+static int mmc_test_seq_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_perf_read(test, 0, 0);
+}
+
+static int mmc_test_seq_read_perf_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf_read(test, 0, 1);
+}
+
+static int mmc_test_rnd_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_perf_read(test, 1, 0);
+}
+
+static int mmc_test_rnd_read_perf_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf_read(test, 1, 1);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -1038,6 +1187,30 @@ static const struct mmc_test_case mmc_test_cases[] = {
 
 #endif /* CONFIG_HIGHMEM */
 
+	{
+		.name = "Sequential read performance, blocking",
+		.prepare = mmc_test_prepare_perf,
+		.run = mmc_test_seq_read_perf,
+	},
+
+	{
+		.name = "Sequential read performance, non-blocking",
+		.prepare = mmc_test_prepare_perf,
+		.run = mmc_test_seq_read_perf_nonblock,
+	},
+
+	{
+		.name = "Random read performance, blocking",
+		.prepare = mmc_test_prepare_perf,
+		.run = mmc_test_rnd_read_perf,
+	},
+
+	{
+		.name = "Random read performance, non-blocking",
+		.prepare = mmc_test_prepare_perf,
+		.run = mmc_test_rnd_read_perf_nonblock,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
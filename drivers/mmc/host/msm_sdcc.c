@@ -326,8 +326,10 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 		if (!mrq->data->error)
 			mrq->data->error = -EIO;
 	}
-	dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg, host->dma.num_ents,
-		     host->dma.dir);
+	/* Requests mapped in msmsdcc_pre_req() are unmapped in post_req */
+	if (!mrq->data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg,
+			     host->dma.num_ents, host->dma.dir);
 
 	if (host->curr.user_pages) {
 		struct scatterlist *sg = host->dma.sg;
@@ -417,6 +419,14 @@ static int validate_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	return 0;
 }
 
+static inline enum dma_data_direction
+msmsdcc_get_dma_dir(struct mmc_data *data)
+{
+	if (data->flags & MMC_DATA_READ)
+		return DMA_FROM_DEVICE;
+	return DMA_TO_DEVICE;
+}
+
 static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 {
 	struct msmsdcc_nc_dmadata *nc;
@@ -453,13 +463,16 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	else {
 		host->dma.sg = NULL;
 		host->dma.num_ents = 0;
+		if (data->host_cookie) {
+			/* Fall back to PIO: undo the mapping from pre_req */
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len, msmsdcc_get_dma_dir(data));
+			data->host_cookie = 0;
+		}
 		return -ENOENT;
 	}
 
-	if (data->flags & MMC_DATA_READ)
-		host->dma.dir = DMA_FROM_DEVICE;
-	else
-		host->dma.dir = DMA_TO_DEVICE;
+	host->dma.dir = msmsdcc_get_dma_dir(data);
 
 	/* host->curr.user_pages = (data->flags & MMC_DATA_USERPAGE); */
 	host->curr.user_pages = 0;
@@ -511,9 +524,14 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	host->dma.hdr.complete_func = msmsdcc_dma_complete_func;
 	host->dma.hdr.crci_mask = msm_dmov_build_crci_mask(1, crci);
 
-	n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
-			host->dma.num_ents, host->dma.dir);
-	/* dsb inside dma_map_sg will write nc out to mem as well */
+	/* The sg list may already have been mapped by msmsdcc_pre_req() */
+	if (data->host_cookie)
+		n = host->dma.num_ents;
+	else
+		n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
+				host->dma.num_ents, host->dma.dir);
+	/* make sure nc is out to mem even when dma_map_sg was skipped */
+	dsb();
 
 	if (n != host->dma.num_ents) {
 		pr_err("%s: Unable to map in all sg elements\n",
@@ -1575,9 +1593,59 @@ static int msmsdcc_disable(struct mmc_host *mmc, int lazy)
 	return rc;
 }
 
+/*
+ * Map the sg list of the next request while the DataMover is still busy
+ * with the current one, so the cache maintenance in dma_map_sg() is off
+ * the critical path.  Requests that will go out in PIO mode are left
+ * alone.
+ */
+static void
+msmsdcc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+		bool is_first_req)
+{
+	struct msmsdcc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int n;
+
+	if (!data)
+		return;
+
+	data->host_cookie = 0;
+	if (validate_dma(host, data))
+		return;
+
+	BUG_ON(data->sg_len > NR_SG);
+
+	n = dma_map_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		       msmsdcc_get_dma_dir(data));
+	if (n != data->sg_len) {
+		if (n)
+			dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+				     msmsdcc_get_dma_dir(data));
+		return;
+	}
+
+	data->host_cookie = 1;
+}
+
+static void
+msmsdcc_post_req(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	struct mmc_data *data = mrq->data;
+
+	if (!data || !data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		     msmsdcc_get_dma_dir(data));
+	data->host_cookie = 0;
+}
+
 static const struct mmc_host_ops msmsdcc_ops = {
 	.enable		= msmsdcc_enable,
 	.disable	= msmsdcc_disable,
+	.pre_req	= msmsdcc_pre_req,
+	.post_req	= msmsdcc_post_req,
 	.request	= msmsdcc_request,
 	.set_ios	= msmsdcc_set_ios,
 	.get_ro		= msmsdcc_get_ro,
@@ -372,6 +372,103 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * rather than into the read_page cache and then copying.  Every page of
+ * the block must be grabbed for this to work; if any is unavailable
+ * (locked by someone else, or already uptodate) -EAGAIN is returned and
+ * the caller falls back to the cache, as it does for -ENOMEM.  On success all pages but
+ * target_page are marked uptodate and released; target_page is left
+ * locked for the caller.
+ */
+static int squashfs_readpage_direct(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int i, n, pages, bytes, res = -ENOMEM;
+	struct page **page;
+	void **pageaddr;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+
+	page = kmalloc(pages * sizeof(*page), GFP_KERNEL);
+	if (page == NULL)
+		return res;
+
+	pageaddr = kmalloc(pages * sizeof(*pageaddr), GFP_KERNEL);
+	if (pageaddr == NULL)
+		goto out;
+
+	/* Try to grab all the pages covered by the datablock */
+	for (i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] == NULL)
+			break;
+
+		if (PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			page_cache_release(page[i]);
+			break;
+		}
+	}
+
+	if (i < pages) {
+		res = -EAGAIN;
+		pages = i;
+		goto release_pages;
+	}
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+
+	/* Zero whatever the block did not fill, to the end of the last page */
+	for (n = res; res >= 0 && n < pages << PAGE_CACHE_SHIFT; n += bytes) {
+		i = n >> PAGE_CACHE_SHIFT;
+		bytes = PAGE_CACHE_SIZE - (n & (PAGE_CACHE_SIZE - 1));
+		memset(pageaddr[i] + (n & (PAGE_CACHE_SIZE - 1)), 0, bytes);
+	}
+
+	for (i = 0; i < pages; i++) {
+		kunmap(page[i]);
+		flush_dcache_page(page[i]);
+	}
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		res = -EIO;
+	} else
+		res = 0;
+
+release_pages:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == target_page)
+			continue;
+		if (res == 0)
+			SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+	kfree(pageaddr);
+out:
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -411,8 +508,19 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			sparse = 1;
 		} else {
 			/*
-			 * Read and decompress datablock.
+			 * Read and decompress datablock, directly into the
+			 * page cache if we can.
 			 */
+			int res = squashfs_readpage_direct(page, block, bsize);
+
+			if (res == 0) {
+				SetPageUptodate(page);
+				unlock_page(page);
+				return 0;
+			}
+			if (res == -EIO)
+				goto error_out;
+
 			buffer = squashfs_get_datablock(inode->i_sb,
 								block, bsize);
 			if (buffer->error) {
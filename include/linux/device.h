@@ -127,6 +127,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	bool probe_async;		/* probe devices from an async thread */
 
 	int (*probe) (struct device *dev);
 	int (*remove) (struct device *dev);
@@ -150,6 +151,7 @@ extern struct device_driver *driver_find(const char *name,
 					 struct bus_type *bus);
 extern int driver_probe_done(void);
 extern void wait_for_device_probe(void);
+extern int wait_for_driver_probe(struct device_driver *drv);
 
 
 /* sysfs interface for exporting driver attributes */
@@ -46,6 +46,17 @@ struct early_suspend {
 	int level;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	/*
+	 * Set once the hooks are known not to depend on, or race with, any
+	 * other handler of the same level: they may then run concurrently
+	 * with the rest of that level. The level order is kept either way.
+	 */
+	int async;
+	/* Hook durations in microseconds, kept by the early suspend core */
+	unsigned int suspend_us;
+	unsigned int suspend_max_us;
+	unsigned int resume_us;
+	unsigned int resume_max_us;
 #endif
 };
 
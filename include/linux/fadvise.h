@@ -18,4 +18,10 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/*
+ * Linux specific: shared code such as framework jars and dex files, to be
+ * read in and kept resident in preference to other page cache.
+ */
+#define POSIX_FADV_HOTCODE	8
+
 #endif	/* FADVISE_H_INCLUDED */
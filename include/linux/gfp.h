@@ -327,6 +327,10 @@ extern void __free_pages(struct page *page, unsigned int order);
 extern void free_pages(unsigned long addr, unsigned int order);
 extern void free_hot_page(struct page *page);
 
+extern unsigned int alloc_pages_bulk(gfp_t gfp_mask, unsigned int nr_pages,
+				     struct page **pages);
+extern void free_pages_bulk(unsigned int nr_pages, struct page **pages);
+
 #define __free_page(page) __free_pages((page), 0)
 #define free_page(addr) free_pages((addr),0)
 
@@ -174,6 +174,7 @@ struct hrtimer_cpu_base {
 	ktime_t				expires_next;
 	int				hres_active;
 	unsigned long			nr_events;
+	unsigned long			nr_merged;
 #endif
 };
 
@@ -142,6 +142,7 @@ extern int do_one_initcall(initcall_t fn);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int reset_devices;
+extern int initcall_debug;
 
 /* used by init/main.c */
 void setup_arch(char **);
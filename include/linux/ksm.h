@@ -17,14 +17,42 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags);
 int __ksm_enter(struct mm_struct *mm);
 void __ksm_exit(struct mm_struct *mm);
+int __ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm);
+
+extern unsigned int ksm_nr_merge_comms;
+
+/*
+ * Areas KSM will not touch, whether asked to by madvise or not.
+ */
+#define VM_KSM_EXCLUDED	(VM_SHARED  | VM_MAYSHARE   | VM_PFNMAP    | \
+			 VM_IO      | VM_DONTEXPAND | VM_RESERVED  | \
+			 VM_HUGETLB | VM_INSERTPAGE | VM_MIXEDMAP  | \
+			 VM_SAO)
 
 static inline int ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
 {
-	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags))
-		return __ksm_enter(mm);
+	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags) || ksm_nr_merge_comms)
+		return __ksm_fork(mm, oldmm);
 	return 0;
 }
 
+/*
+ * In an mm that merges all private areas (a child of a task named in
+ * /sys/kernel/mm/ksm/merge_comm), new areas are mergeable unless they
+ * are of a kind that KSM would refuse to madvise.
+ */
+static inline unsigned long ksm_vma_flags(struct mm_struct *mm,
+					  unsigned long vm_flags)
+{
+	if (test_bit(MMF_VM_MERGE_ANY, &mm->flags)) {
+		if (vm_flags & VM_KSM_EXCLUDED)
+			vm_flags &= ~VM_MERGEABLE;
+		else
+			vm_flags |= VM_MERGEABLE;
+	}
+	return vm_flags;
+}
+
 static inline void ksm_exit(struct mm_struct *mm)
 {
 	if (test_bit(MMF_VM_MERGEABLE, &mm->flags))
@@ -64,6 +92,12 @@ static inline int ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
 	return 0;
 }
 
+static inline unsigned long ksm_vma_flags(struct mm_struct *mm,
+					  unsigned long vm_flags)
+{
+	return vm_flags;
+}
+
 static inline void ksm_exit(struct mm_struct *mm)
 {
 }
@@ -1194,6 +1194,23 @@ unsigned long ra_submit(struct file_ra_state *ra,
 			struct address_space *mapping,
 			struct file *filp);
 
+/* mm/boot_prefetch.c */
+#ifdef CONFIG_BOOT_PREFETCH
+extern int boot_prefetch_recording;
+void __boot_prefetch_record(struct file *filp, pgoff_t index);
+
+/* Note a page about to be read in because it was not cached */
+static inline void boot_prefetch_record(struct file *filp, pgoff_t index)
+{
+	if (unlikely(boot_prefetch_recording))
+		__boot_prefetch_record(filp, index);
+}
+#else
+static inline void boot_prefetch_record(struct file *filp, pgoff_t index)
+{
+}
+#endif
+
 /* Do stack extension */
 extern int expand_stack(struct vm_area_struct *vma, unsigned long address);
 #ifdef CONFIG_IA64
@@ -10,10 +10,12 @@
 
 #include <linux/interrupt.h>
 #include <linux/device.h>
+#include <linux/completion.h>
 
 struct request;
 struct mmc_data;
 struct mmc_request;
+struct mmc_card;
 
 struct mmc_command {
 	u32			opcode;
@@ -115,6 +117,7 @@ struct mmc_data {
 
 	unsigned int		sg_len;		/* size of scatter list */
 	struct scatterlist	*sg;		/* I/O scatter list */
+	s32			host_cookie;	/* host private data */
 };
 
 struct mmc_request {
@@ -126,10 +129,23 @@ struct mmc_request {
 	void			(*done)(struct mmc_request *);/* completion function */
 };
 
+/*
+ * A request handed to mmc_start_req().  The core keeps at most one of
+ * these in flight per host; err_check is called once the transfer has
+ * completed to decide whether the next queued request may be started.
+ */
+struct mmc_async_req {
+	struct mmc_request	*mrq;
+	struct completion	complete;
+	int (*err_check)(struct mmc_card *, struct mmc_async_req *);
+};
+
 struct mmc_host;
 struct mmc_card;
 
 extern int mmc_wait_for_req(struct mmc_host *, struct mmc_request *); //sw2-6-1-RH-Wlan_Reset7-00*
+extern struct mmc_async_req *mmc_start_req(struct mmc_host *,
+					   struct mmc_async_req *, int *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
 extern int mmc_wait_for_app_cmd(struct mmc_host *, struct mmc_card *,
 	struct mmc_command *, int);
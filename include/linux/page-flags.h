@@ -99,6 +99,7 @@ enum pageflags {
 	PG_buddy,		/* Page is free, on buddy lists */
 	PG_swapbacked,		/* Page is backed by RAM/swap */
 	PG_unevictable,		/* Page is "unevictable"  */
+	PG_hotcode,		/* Shared code, protected from reclaim */
 #ifdef CONFIG_HAVE_MLOCKED_PAGE_BIT
 	PG_mlocked,		/* Page is vma mlocked */
 #endif
@@ -259,6 +260,13 @@ PAGEFLAG_FALSE(SwapCache)
 PAGEFLAG(Unevictable, unevictable) __CLEARPAGEFLAG(Unevictable, unevictable)
 	TESTCLEARFLAG(Unevictable, unevictable)
 
+/*
+ * PG_hotcode marks page cache advised with POSIX_FADV_HOTCODE. Such pages
+ * stay on the normal LRU lists, but reclaim passes over them under
+ * moderate pressure. Counted in NR_HOTCODE while set.
+ */
+PAGEFLAG(Hotcode, hotcode) TESTSCFLAG(Hotcode, hotcode)
+
 #ifdef CONFIG_HAVE_MLOCKED_PAGE_BIT
 #define MLOCK_PAGES 1
 PAGEFLAG(Mlocked, mlocked) __CLEARPAGEFLAG(Mlocked, mlocked)
@@ -475,6 +475,7 @@ extern int get_dumpable(struct mm_struct *mm);
 #endif
 					/* leave room for more dump flags */
 #define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
+#define MMF_VM_MERGE_ANY	17	/* KSM may merge all private areas */
 
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
 
@@ -1129,6 +1130,20 @@ struct load_weight {
  *     4 se->sleep_start
  *     6 se->load.weight
  */
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking: the time spent running, as a geometric
+ * series over ~1ms periods in which each period weighs y times the
+ * next more recent one, with y^32 = 1/2. running_sum / period_sum is
+ * the recent utilization; see __update_sched_avg().
+ */
+struct sched_avg {
+	u64			last_update;
+	u32			running_sum;
+	u32			period_sum;
+};
+#endif
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1150,6 +1165,10 @@ struct sched_entity {
 
 	u64			avg_running;
 
+#ifdef CONFIG_SMP
+	struct sched_avg	avg;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	u64			wait_start;
 	u64			wait_max;
@@ -1736,6 +1755,7 @@ extern int task_free_unregister(struct notifier_block *n);
 #define PF_EXITING	0x00000004	/* getting shut down */
 #define PF_EXITPIDONE	0x00000008	/* pi exit done on shut down */
 #define PF_VCPU		0x00000010	/* I'm a virtual CPU */
+#define PF_WQ_WORKER	0x00000020	/* I'm a workqueue pool worker */
 #define PF_FORKNOEXEC	0x00000040	/* forked but didn't exec */
 #define PF_MCE_PROCESS  0x00000080      /* process policy on mce errors */
 #define PF_SUPERPRIV	0x00000100	/* used super-user privileges */
@@ -1902,6 +1922,13 @@ extern unsigned int sysctl_sched_wakeup_granularity;
 extern unsigned int sysctl_sched_shares_ratelimit;
 extern unsigned int sysctl_sched_shares_thresh;
 extern unsigned int sysctl_sched_child_runs_first;
+#ifdef CONFIG_SMP
+extern unsigned int sysctl_sched_pack_small_tasks;
+extern unsigned int sysctl_sched_small_task_pct;
+extern unsigned int sysctl_sched_pack_cpu_pct;
+
+extern unsigned int sched_cpu_util(int cpu);
+#endif
 #ifdef CONFIG_SCHED_DEBUG
 extern unsigned int sysctl_sched_features;
 extern unsigned int sysctl_sched_migration_cost;
@@ -1924,6 +1951,9 @@ static inline unsigned int get_sysctl_timer_migration(void)
 	return 1;
 }
 #endif
+extern unsigned long sysctl_timer_slack_background_ns;
+extern unsigned long task_timer_slack(struct task_struct *task);
+
 extern unsigned int sysctl_sched_rt_period;
 extern int sysctl_sched_rt_runtime;
 
@@ -16,6 +16,22 @@
 #include <linux/compiler.h>
 #include <linux/kmemtrace.h>
 
+#ifdef CONFIG_SLAB_STATS
+/*
+ * Fast path statistics of one cpu, updated with interrupts disabled:
+ * how often its array_cache could serve an allocation or take a free,
+ * and the time spent refilling or flushing it when it could not.
+ */
+struct kmem_cache_cpu_stats {
+	unsigned long allochit;
+	unsigned long allocmiss;
+	unsigned long freehit;
+	unsigned long freemiss;
+	u64 refill_ns;
+	u64 flush_ns;
+} ____cacheline_aligned_in_smp;
+#endif
+
 /*
  * struct kmem_cache
  *
@@ -83,6 +99,9 @@ struct kmem_cache {
 	int obj_offset;
 	int obj_size;
 #endif /* CONFIG_DEBUG_SLAB */
+#ifdef CONFIG_SLAB_STATS
+	struct kmem_cache_cpu_stats cpu_stats[NR_CPUS];
+#endif
 
 	/*
 	 * We put nodelists[] at the end of kmem_cache, because we want to size
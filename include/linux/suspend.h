@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/errno.h>
 
 #if defined(CONFIG_PM_SLEEP) && defined(CONFIG_VT) && defined(CONFIG_VT_CONSOLE)
@@ -273,6 +274,17 @@ static inline void hibernate_nvs_save(void) {}
 static inline void hibernate_nvs_restore(void) {}
 #endif /* CONFIG_HIBERNATION_NVS */
 
+/*
+ * Steps of a system suspend, outside the device callbacks, whose
+ * duration is traced and kept for debugfs/pm_timing.
+ */
+enum {
+	PM_STEP_SYS_SYNC,	/* suspend_sys_sync() */
+	PM_STEP_SYNC_WAIT,	/* waiting for it in suspend_sys_sync_wait() */
+	PM_STEP_FREEZE,		/* freezing user space, polling the wake locks */
+	PM_STEP_COUNT,
+};
+
 #ifdef CONFIG_PM_SLEEP
 void save_processor_state(void);
 void restore_processor_state(void);
@@ -286,6 +298,9 @@ extern int unregister_pm_notifier(struct notifier_block *nb);
 		{ .notifier_call = fn, .priority = pri };	\
 	register_pm_notifier(&fn##_nb);			\
 }
+
+/* drivers/base/power/timing.c */
+extern void pm_report_step_time(int step, ktime_t start);
 #else /* !CONFIG_PM_SLEEP */
 
 static inline int register_pm_notifier(struct notifier_block *nb)
@@ -299,6 +314,8 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 }
 
 #define pm_notifier(fn, pri)	do { (void)(fn); } while (0)
+
+static inline void pm_report_step_time(int step, ktime_t start) {}
 #endif /* !CONFIG_PM_SLEEP */
 
 extern struct mutex pm_mutex;
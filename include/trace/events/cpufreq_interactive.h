@@ -0,0 +1,118 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/tracepoint.h>
+
+/* A load sample was evaluated */
+TRACE_EVENT(cpufreq_interactive_target,
+
+	TP_PROTO(unsigned int cpu, unsigned int load, unsigned int curtarg,
+		 unsigned int newtarg, int idle_exit),
+
+	TP_ARGS(cpu, load, curtarg, newtarg, idle_exit),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	curtarg		)
+		__field(	unsigned int,	newtarg		)
+		__field(	int,		idle_exit	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->newtarg = newtarg;
+		__entry->idle_exit = idle_exit;
+	),
+
+	TP_printk("cpu=%u load=%u cur=%u target=%u%s",
+		  __entry->cpu, __entry->load, __entry->curtarg,
+		  __entry->newtarg, __entry->idle_exit ? " idle_exit" : "")
+);
+
+/* A speed drop was held back by min_sample_time */
+TRACE_EVENT(cpufreq_interactive_notyet,
+
+	TP_PROTO(unsigned int cpu, unsigned int load, unsigned int curtarg,
+		 unsigned int newtarg),
+
+	TP_ARGS(cpu, load, curtarg, newtarg),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	curtarg		)
+		__field(	unsigned int,	newtarg		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->newtarg = newtarg;
+	),
+
+	TP_printk("cpu=%u load=%u cur=%u target=%u",
+		  __entry->cpu, __entry->load, __entry->curtarg,
+		  __entry->newtarg)
+);
+
+/* Speed raised; ramp_us is the time from start of the busy period */
+TRACE_EVENT(cpufreq_interactive_up,
+
+	TP_PROTO(unsigned int cpu, unsigned int targfreq,
+		 unsigned int actualfreq, unsigned int ramp_us),
+
+	TP_ARGS(cpu, targfreq, actualfreq, ramp_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	targfreq	)
+		__field(	unsigned int,	actualfreq	)
+		__field(	unsigned int,	ramp_us		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->targfreq = targfreq;
+		__entry->actualfreq = actualfreq;
+		__entry->ramp_us = ramp_us;
+	),
+
+	TP_printk("cpu=%u target=%u actual=%u ramp_us=%u",
+		  __entry->cpu, __entry->targfreq, __entry->actualfreq,
+		  __entry->ramp_us)
+);
+
+TRACE_EVENT(cpufreq_interactive_down,
+
+	TP_PROTO(unsigned int cpu, unsigned int targfreq,
+		 unsigned int actualfreq),
+
+	TP_ARGS(cpu, targfreq, actualfreq),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	targfreq	)
+		__field(	unsigned int,	actualfreq	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->targfreq = targfreq;
+		__entry->actualfreq = actualfreq;
+	),
+
+	TP_printk("cpu=%u target=%u actual=%u",
+		  __entry->cpu, __entry->targfreq, __entry->actualfreq)
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -4,6 +4,7 @@
 #if !defined(_TRACE_POWER_H) || defined(TRACE_HEADER_MULTI_READ)
 #define _TRACE_POWER_H
 
+#include <linux/device.h>
 #include <linux/ktime.h>
 #include <linux/tracepoint.h>
 
@@ -75,6 +76,55 @@ TRACE_EVENT(power_frequency,
 	TP_printk("type=%lu state=%lu", (unsigned long)__entry->type, (unsigned long) __entry->state)
 );
 
+/* A device suspend or resume callback returned */
+TRACE_EVENT(device_pm_report_time,
+
+	TP_PROTO(struct device *dev, const char *pm_ops, unsigned int usecs,
+		 int error),
+
+	TP_ARGS(dev, pm_ops, usecs, error),
+
+	TP_STRUCT__entry(
+		__string(	device,		dev_name(dev)		)
+		__string(	driver,		dev_driver_string(dev)	)
+		__string(	pm_ops,		pm_ops			)
+		__field(	unsigned int,	usecs			)
+		__field(	int,		error			)
+	),
+
+	TP_fast_assign(
+		__assign_str(device, dev_name(dev));
+		__assign_str(driver, dev_driver_string(dev));
+		__assign_str(pm_ops, pm_ops);
+		__entry->usecs = usecs;
+		__entry->error = error;
+	),
+
+	TP_printk("%s %s %s took %u us, error %d", __get_str(driver),
+		  __get_str(device), __get_str(pm_ops), __entry->usecs,
+		  __entry->error)
+);
+
+/* A system-wide suspend step outside the device callbacks finished */
+TRACE_EVENT(pm_step_time,
+
+	TP_PROTO(const char *step, unsigned int usecs),
+
+	TP_ARGS(step, usecs),
+
+	TP_STRUCT__entry(
+		__string(	step,		step			)
+		__field(	unsigned int,	usecs			)
+	),
+
+	TP_fast_assign(
+		__assign_str(step, step);
+		__entry->usecs = usecs;
+	),
+
+	TP_printk("%s took %u us", __get_str(step), __entry->usecs)
+);
+
 #endif /* _TRACE_POWER_H */
 
 /* This part must be outside protection */
@@ -1311,6 +1311,10 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 				break;
 			}
 
+			/* Run early, on the wakeup of another timer */
+			if (basenow.tv64 < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_merged++;
+
 			__run_hrtimer(timer, &basenow);
 		}
 		base++;
@@ -1528,6 +1532,44 @@ out:
 	return ret;
 }
 
+/*
+ * Threads of background processes run SCHED_BATCH, or at a nice level
+ * of TIMER_SLACK_BACKGROUND_NICE or more, and hardly ever need their
+ * timeouts to be precise. Unless they set a slack of their own with
+ * PR_SET_TIMERSLACK, they get at least sysctl_timer_slack_background_ns,
+ * so that their nanosleep(), poll(), select(), epoll_wait() and futex
+ * timeouts can be run from the wakeups of other timers. Realtime tasks
+ * keep their own slack whatever their nice level.
+ *
+ * The floor is /proc/sys/kernel/timer_slack_background_ns, 50ms by
+ * default; 0 leaves background tasks with their usual slack. It applies
+ * to timeouts armed after it is changed.
+ */
+#define TIMER_SLACK_BACKGROUND_NICE	10
+
+unsigned long sysctl_timer_slack_background_ns __read_mostly =
+	50 * NSEC_PER_MSEC;
+
+/**
+ * task_timer_slack - timer slack in effect for a task
+ * @task:	the task
+ *
+ * Returns the slack in nanoseconds to apply to @task's timeouts.
+ */
+unsigned long task_timer_slack(struct task_struct *task)
+{
+	unsigned long slack = task->timer_slack_ns;
+
+	if (rt_task(task))
+		return slack;
+	if (slack == task->default_timer_slack_ns &&
+	    (task->policy == SCHED_BATCH || task->policy == SCHED_IDLE ||
+	     task_nice(task) >= TIMER_SLACK_BACKGROUND_NICE))
+		slack = max(slack, sysctl_timer_slack_background_ns);
+
+	return slack;
+}
+
 long hrtimer_nanosleep(struct timespec *rqtp, struct timespec __user *rmtp,
 		       const enum hrtimer_mode mode, const clockid_t clockid)
 {
@@ -1536,7 +1578,7 @@ long hrtimer_nanosleep(struct timespec *rqtp, struct timespec __user *rmtp,
 	int ret = 0;
 	unsigned long slack;
 
-	slack = current->timer_slack_ns;
+	slack = task_timer_slack(current);
 	if (rt_task(current))
 		slack = 0;
 
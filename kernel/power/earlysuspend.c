@@ -13,7 +13,9 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/earlysuspend.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
@@ -22,7 +24,6 @@
 
 //Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
 #ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
-#include <linux/ktime.h>
 #include <linux/hrtimer.h>
 #include <linux/kallsyms.h>
 #endif
@@ -55,8 +56,13 @@ enum {
 
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/* Run async handlers concurrently with their level; 0 calls all in turn */
+static int parallel = 1;
+module_param_named(parallel, parallel, int, S_IRUGO | S_IWUSR | S_IWGRP);
+
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
+static LIST_HEAD(early_suspend_domain);
 static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
@@ -101,19 +107,94 @@ extern void open_dorm_fifo(void);
 #endif	// CONFIG_FIH_FXX
 //[---] Add for fast dormancy
 
-static void early_suspend(struct work_struct *work)
+static void call_handler(struct early_suspend *pos, int resume)
 {
-	struct early_suspend *pos;
-	unsigned long irqflags;
-	int abort = 0;
+	ktime_t calltime;
+	unsigned int usecs;
 
+	calltime = ktime_get();
 //Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
 #ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
-    ktime_t calltime, delta, rettime;
-    unsigned long long duration;
+	if (resume)
+		print_symbol("late_resume function: %s\n", (unsigned long)pos->resume); //Div2-SW2-BSP-EarlySuspendLog-02*
+	else
+		print_symbol("early suspend function: %s\n", (unsigned long)pos->suspend);
 #endif
 //Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai-]
 
+	if (resume)
+		pos->resume(pos);
+	else
+		pos->suspend(pos);
+
+	usecs = ktime_to_us(ktime_sub(ktime_get(), calltime));
+//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
+#ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
+	pr_info("takes %u usecs\n", usecs);
+#endif
+//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai-]
+	if (resume) {
+		pos->resume_us = usecs;
+		if (usecs > pos->resume_max_us)
+			pos->resume_max_us = usecs;
+	} else {
+		pos->suspend_us = usecs;
+		if (usecs > pos->suspend_max_us)
+			pos->suspend_max_us = usecs;
+	}
+}
+
+static void early_suspend_async(void *data, async_cookie_t cookie)
+{
+	call_handler(data, 0);
+}
+
+static void late_resume_async(void *data, async_cookie_t cookie)
+{
+	call_handler(data, 1);
+}
+
+/*
+ * Call the suspend hooks in level order, or the resume hooks in reverse
+ * level order. Handlers marked async are started in the background and
+ * the others are called one by one in this thread; the next level only
+ * starts once all handlers of this one have returned. Called with
+ * early_suspend_lock held.
+ */
+static void call_handlers(int resume)
+{
+	struct list_head *head = &early_suspend_handlers;
+	struct list_head *p, *next;
+	struct early_suspend *pos;
+	int last;
+
+	for (p = resume ? head->prev : head->next; p != head; p = next) {
+		pos = list_entry(p, struct early_suspend, link);
+		next = resume ? p->prev : p->next;
+		last = next == head ||
+			list_entry(next, struct early_suspend, link)->level !=
+			pos->level;
+
+		if (resume ? pos->resume : pos->suspend) {
+			if (parallel && pos->async)
+				async_schedule_domain(resume ?
+						late_resume_async :
+						early_suspend_async,
+						pos, &early_suspend_domain);
+			else
+				call_handler(pos, resume);
+		}
+
+		if (last)
+			async_synchronize_full_domain(&early_suspend_domain);
+	}
+}
+
+static void early_suspend(struct work_struct *work)
+{
+	unsigned long irqflags;
+	int abort = 0;
+
 #if defined(CONFIG_FIH_POWER_LOG) && defined(CONFIG_BATTERY_FIH_MSM)
 	struct batt_info_interface* batt_info_if = get_batt_info_if();
 #endif
@@ -150,26 +231,7 @@ static void early_suspend(struct work_struct *work)
 #endif
 //Div2-SW2-BSP-pmlog, HenryMCWang -
 	
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
-#ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
-		if (pos->suspend != NULL) {
-            calltime = ktime_get();
-            print_symbol("early suspend function: %s\n", (unsigned long)pos->suspend);
-
-			pos->suspend(pos);
-
-            rettime = ktime_get();
-            delta = ktime_sub(rettime, calltime);
-            duration = (unsigned long long) ktime_to_ns(delta) >> 10;
-            pr_info("takes %Ld usecs\n", duration);
-        }
-#else
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-#endif
-//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai-]
-	}
+	call_handlers(0);
 	mutex_unlock(&early_suspend_lock);
 
 //[+++] Add for fast dormancy
@@ -196,17 +258,9 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
 
-//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
-#ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
-    ktime_t calltime, delta, rettime;
-    unsigned long long duration;
-#endif
-//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai-]
-
 #if defined(CONFIG_FIH_POWER_LOG) && defined(CONFIG_BATTERY_FIH_MSM)
 	struct batt_info_interface* batt_info_if = get_batt_info_if();
 #endif
@@ -234,24 +288,7 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
-//Div2-SW2-BSP-EarlySuspendLog, VinceCCTsai+[
-#ifdef CONFIG_FIH_SUSPEND_RESUME_LOG
-		if (pos->resume != NULL) {
-            calltime = ktime_get();
-            print_symbol("late_resume function: %s\n", (unsigned long)pos->resume); //Div2-SW2-BSP-EarlySuspendLog-02*
-
-			pos->resume(pos);
-
-            rettime = ktime_get();
-            delta = ktime_sub(rettime, calltime);
-            duration = (unsigned long long) ktime_to_ns(delta) >> 10;
-            pr_info("takes %Ld usecs\n", duration);
-        }
-#else
-		if (pos->resume != NULL)
-			pos->resume(pos);
-#endif
+	call_handlers(1);
 
 //Div2-SW2-BSP-pmlog, HenryMCWang +
 	#if defined(CONFIG_FIH_POWER_LOG) && defined(CONFIG_BATTERY_FIH_MSM)
@@ -333,3 +370,46 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+/*
+ * /sys/power/early_suspend_stats: the last and longest run of each hook,
+ * in microseconds, in suspend order. Writing anything clears the maxima.
+ */
+ssize_t early_suspend_stats_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct early_suspend *pos;
+	int len;
+
+	len = scnprintf(buf, PAGE_SIZE, "level  suspend_us     max_us  "
+			"resume_us     max_us  handler\n");
+
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%5d %11u %10u %10u %10u  %pf\n",
+				 pos->level, pos->suspend_us,
+				 pos->suspend_max_us, pos->resume_us,
+				 pos->resume_max_us,
+				 pos->suspend ? (void *)pos->suspend :
+						(void *)pos->resume);
+	mutex_unlock(&early_suspend_lock);
+
+	return len;
+}
+
+ssize_t early_suspend_stats_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t n)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		pos->suspend_max_us = 0;
+		pos->resume_max_us = 0;
+	}
+	mutex_unlock(&early_suspend_lock);
+
+	return n;
+}
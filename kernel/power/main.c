@@ -219,6 +219,10 @@ power_attr(wake_lock);
 power_attr(wake_unlock);
 #endif
 
+#ifdef CONFIG_EARLYSUSPEND
+power_attr(early_suspend_stats);
+#endif
+
 static struct attribute * g[] = {
 	&state_attr.attr,
 #ifdef CONFIG_PM_TRACE
@@ -230,6 +234,9 @@ static struct attribute * g[] = {
 #ifdef CONFIG_USER_WAKELOCK
 	&wake_lock_attr.attr,
 	&wake_unlock_attr.attr,
+#endif
+#ifdef CONFIG_EARLYSUSPEND
+	&early_suspend_stats_attr.attr,
 #endif
 	NULL,
 };
@@ -40,6 +40,7 @@ static int try_to_freeze_tasks(bool sig_only)
 	u64 elapsed_csecs64;
 	unsigned int elapsed_csecs;
 	unsigned int wakeup = 0;
+	ktime_t calltime = ktime_get();
 
 	do_gettimeofday(&start);
 
@@ -74,6 +75,9 @@ static int try_to_freeze_tasks(bool sig_only)
 			break;
 	} while (todo);
 
+	if (sig_only)
+		pm_report_step_time(PM_STEP_FREEZE, calltime);
+
 	do_gettimeofday(&end);
 	elapsed_csecs64 = timeval_to_ns(&end) - timeval_to_ns(&start);
 	do_div(elapsed_csecs64, NSEC_PER_SEC / 100);
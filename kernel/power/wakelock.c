@@ -51,9 +51,23 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 #define POLLING_DUMP_WAKELOCK_SECS	(90)	//Div251-PK-Dump_Wakelock-00+
 
+/* How late expire_timer may run, to share a wakeup with other timers */
+#define EXPIRE_TIMER_SLACK		(HZ / 20)
+
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/*
+ * Number of active locks of each type with and without a timeout, and
+ * the latest expiry among the timed ones, so that has_wake_lock() does
+ * not have to walk active_wake_locks on every suspend attempt and idle
+ * entry. timed_expires is only an upper bound once the lock that set
+ * it has gone away; timed_expires_stale then forces a walk.
+ */
+static int active_untimed[WAKE_LOCK_TYPE_COUNT];
+static int active_timed[WAKE_LOCK_TYPE_COUNT];
+static unsigned long timed_expires[WAKE_LOCK_TYPE_COUNT];
+static int timed_expires_stale[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 static struct workqueue_struct *suspend_sys_sync_work_queue;
 static DECLARE_COMPLETION(suspend_sys_sync_comp);
@@ -458,39 +472,43 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
-static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
+/*
+ * The stats helpers take the current time from the caller, which reads
+ * the clock once per wake_lock/wake_unlock instead of once per update.
+ */
+static void wake_unlock_stat_locked(struct wake_lock *lock, int expired,
+				    ktime_t now)
 {
 	ktime_t duration;
-	ktime_t now;
+	ktime_t end;
 	if (!(lock->flags & WAKE_LOCK_ACTIVE))
 		return;
-	if (get_expired_time(lock, &now))
+	if (get_expired_time(lock, &end))
 		expired = 1;
 	else
-		now = ktime_get();
+		end = now;
 	lock->stat.count++;
 	if (expired)
 		lock->stat.expire_count++;
-	duration = ktime_sub(now, lock->stat.last_time);
+	duration = ktime_sub(end, lock->stat.last_time);
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
-	lock->stat.last_time = ktime_get();
+	lock->stat.last_time = now;
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-		duration = ktime_sub(now, last_sleep_time_update);
+		duration = ktime_sub(end, last_sleep_time_update);
 		lock->stat.prevent_suspend_time = ktime_add(
 			lock->stat.prevent_suspend_time, duration);
 		lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
 	}
 }
 
-static void update_sleep_wait_stats_locked(int done)
+static void update_sleep_wait_stats_locked(int done, ktime_t now)
 {
 	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
+	ktime_t etime, elapsed, add;
 	int expired;
 
-	now = ktime_get();
 	elapsed = ktime_sub(now, last_sleep_time_update);
 	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
 		expired = get_expired_time(lock, &etime);
@@ -512,11 +530,41 @@ static void update_sleep_wait_stats_locked(int done)
 #endif
 
 
+/* Account for a lock that just became active; list_lock held */
+static void active_lock_add(struct wake_lock *lock, int type)
+{
+	if (!(lock->flags & WAKE_LOCK_AUTO_EXPIRE)) {
+		active_untimed[type]++;
+		return;
+	}
+	if (!active_timed[type]++) {
+		timed_expires[type] = lock->expires;
+		timed_expires_stale[type] = 0;
+	} else if (time_after(lock->expires, timed_expires[type])) {
+		timed_expires[type] = lock->expires;
+	}
+}
+
+/* Account for a lock about to become inactive; list_lock held */
+static void active_lock_del(struct wake_lock *lock, int type)
+{
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	if (!(lock->flags & WAKE_LOCK_AUTO_EXPIRE)) {
+		active_untimed[type]--;
+		return;
+	}
+	active_timed[type]--;
+	if (lock->expires == timed_expires[type])
+		timed_expires_stale[type] = 1;
+}
+
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
-	wake_unlock_stat_locked(lock, 1);
+	wake_unlock_stat_locked(lock, 1, ktime_get());
 #endif
+	active_lock_del(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -583,25 +631,47 @@ static void pmlog_active_locks(int type)
 #endif
 //Div2-SW2-BSP-pmlog, HenryMCWang -
 
-static long has_wake_lock_locked(int type)
+/*
+ * Expire the timed locks of a type that have run out, and work out when
+ * the last of the others will.
+ */
+static long expire_timed_wake_locks_locked(int type)
 {
 	struct wake_lock *lock, *n;
+	unsigned long now = jiffies;
 	long max_timeout = 0;
 
-	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
 		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
+			long timeout = lock->expires - now;
 			if (timeout <= 0)
 				expire_wake_lock(lock);
 			else if (timeout > max_timeout)
 				max_timeout = timeout;
-		} else
-			return -1;
+		}
 	}
+	timed_expires[type] = now + max_timeout;
+	timed_expires_stale[type] = 0;
 	return max_timeout;
 }
 
+static long has_wake_lock_locked(int type)
+{
+	long timeout;
+
+	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
+	if (active_untimed[type])
+		return -1;
+	if (!active_timed[type])
+		return 0;
+	if (!timed_expires_stale[type]) {
+		timeout = timed_expires[type] - jiffies;
+		if (timeout > 0)
+			return timeout;
+	}
+	return expire_timed_wake_locks_locked(type);
+}
+
 long has_wake_lock(int type)
 {
 	long ret;
@@ -617,7 +687,7 @@ long has_wake_lock(int type)
 //Div251-PK-Dump_Wakelock-00+[
 #ifdef CONFIG_FIH_DUMP_WAKELOCK
 static void dump_wakelocks(unsigned long data);
-static DEFINE_TIMER(dump_wakelock_timer, dump_wakelocks, 0, 0);
+static DEFINE_TIMER_DEFERRABLE(dump_wakelock_timer, dump_wakelocks, 0, 0);
 
 static void dump_wakelocks(unsigned long data)
 {
@@ -638,10 +708,14 @@ static void dump_wakelocks(unsigned long data)
 
 static void suspend_sys_sync(struct work_struct *work)
 {
+	ktime_t start;
+
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("PM: Syncing filesystems ... \n");
 
+	start = ktime_get();
 	sys_sync();
+	pm_report_step_time(PM_STEP_SYS_SYNC, start);
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("sync done.\n");
@@ -677,12 +751,15 @@ static void suspend_sys_sync_handler(unsigned long arg)
 
 int suspend_sys_sync_wait(void)
 {
+	ktime_t start = ktime_get();
+
 	suspend_sys_sync_abort = false;
 	if (!is_workqueue_empty(suspend_sys_sync_work_queue)) {
 		mod_timer(&suspend_sys_sync_timer, jiffies +
 				SUSPEND_SYS_SYNC_TIMEOUT);
 		wait_for_completion(&suspend_sys_sync_comp);
 	}
+	pm_report_step_time(PM_STEP_SYNC_WAIT, start);
 	if (suspend_sys_sync_abort) {
 		pr_info("suspend aborted....while waiting for sys_sync\n");
 		return -EAGAIN;
@@ -838,6 +915,7 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
+	active_lock_del(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
 	lock->flags &= ~WAKE_LOCK_INITIALIZED;
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
@@ -865,12 +943,16 @@ static void wake_lock_internal(
 	int type;
 	unsigned long irqflags;
 	long expire_in;
+#ifdef CONFIG_WAKELOCK_STAT
+	ktime_t now;
+#endif
 
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	BUG_ON(!(lock->flags & WAKE_LOCK_INITIALIZED));
 #ifdef CONFIG_WAKELOCK_STAT
+	now = ktime_get();
 	if (type == WAKE_LOCK_SUSPEND && wait_for_wakeup) {
 		if (debug_mask & DEBUG_WAKEUP)
 			pr_info("wakeup wake lock: %s\n", lock->name);
@@ -879,14 +961,15 @@ static void wake_lock_internal(
 	}
 	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
 	    (long)(lock->expires - jiffies) <= 0) {
-		wake_unlock_stat_locked(lock, 0);
-		lock->stat.last_time = ktime_get();
+		wake_unlock_stat_locked(lock, 0, now);
+		lock->stat.last_time = now;
 	}
 #endif
+	active_lock_del(lock, type);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
-		lock->stat.last_time = ktime_get();
+		lock->stat.last_time = now;
 #endif
 	}
 	list_del(&lock->link);
@@ -905,6 +988,7 @@ static void wake_lock_internal(
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
 	}
+	active_lock_add(lock, type);
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
 //Div251-PK-Dump_Wakelock-00+[
@@ -917,9 +1001,9 @@ static void wake_lock_internal(
 //Div251-PK-Dump_Wakelock-00+]
 #ifdef CONFIG_WAKELOCK_STAT
 		if (lock == &main_wake_lock)
-			update_sleep_wait_stats_locked(1);
+			update_sleep_wait_stats_locked(1, now);
 		else if (!wake_lock_active(&main_wake_lock))
-			update_sleep_wait_stats_locked(0);
+			update_sleep_wait_stats_locked(0, now);
 #endif
 		if (has_timeout)
 			expire_in = has_wake_lock_locked(type);
@@ -958,13 +1042,18 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	ktime_t now;
+#endif
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
-	wake_unlock_stat_locked(lock, 0);
+	now = ktime_get();
+	wake_unlock_stat_locked(lock, 0, now);
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	active_lock_del(lock, type);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -1000,7 +1089,7 @@ void wake_unlock(struct wake_lock *lock)
 #endif /* CONFIG_FIH_DUMP_WAKELOCK */
 //Div251-PK-Dump_Wakelock-00+]
 #ifdef CONFIG_WAKELOCK_STAT
-			update_sleep_wait_stats_locked(0);
+			update_sleep_wait_stats_locked(0, now);
 #endif
 		}
 	}
@@ -1008,9 +1097,19 @@ void wake_unlock(struct wake_lock *lock)
 }
 EXPORT_SYMBOL(wake_unlock);
 
+/*
+ * A timed lock that has run out may still be on the active list: only
+ * the latest expiring one of each type arms the expire timer, and the
+ * others are reaped on the next walk. Treat it as inactive already.
+ */
 int wake_lock_active(struct wake_lock *lock)
 {
-	return !!(lock->flags & WAKE_LOCK_ACTIVE);
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return 0;
+	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
+	    (long)(lock->expires - jiffies) <= 0)
+		return 0;
+	return 1;
 }
 EXPORT_SYMBOL(wake_lock_active);
 
@@ -1039,6 +1138,8 @@ static int __init wakelocks_init(void)
 #endif
 //SW2-5-1-HC-Suspend_Hang_Timer-00+]
 
+	set_timer_slack(&expire_timer, EXPIRE_TIMER_SLACK);
+
 	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
 		INIT_LIST_HEAD(&active_wake_locks[i]);
 
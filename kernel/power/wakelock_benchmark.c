@@ -0,0 +1,77 @@
+/*
+ * kernel/power/wakelock_benchmark.c - wake lock fast path benchmark.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/wakelock.h>
+
+/*
+ * Time wake_lock()/wake_unlock() pairs on a suspend lock, and the
+ * has_wake_lock(WAKE_LOCK_IDLE) check made on every idle entry, while a
+ * varying number of timed idle locks is held. Timed locks are the
+ * expensive case for has_wake_lock(); one held without a timeout
+ * answers it straight away. Results go to the kernel log at boot.
+ */
+#define BENCH_LOOPS		10000
+#define BENCH_MAX_HELD		64
+
+static struct wake_lock bench_lock __initdata;
+static struct wake_lock bench_held[BENCH_MAX_HELD] __initdata;
+
+static const int bench_held_counts[] __initdata = { 0, 4, 16, BENCH_MAX_HELD };
+
+static u64 __init wakelock_bench_run(int pairs)
+{
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		if (pairs) {
+			wake_lock(&bench_lock);
+			wake_unlock(&bench_lock);
+		} else {
+			has_wake_lock(WAKE_LOCK_IDLE);
+		}
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? ns : 1;
+}
+
+static int __init wakelock_benchmark(void)
+{
+	int i, n, held = 0;
+	u64 pair_ns, check_ns;
+
+	wake_lock_init(&bench_lock, WAKE_LOCK_SUSPEND, "wakelock_bench");
+	for (i = 0; i < BENCH_MAX_HELD; i++)
+		wake_lock_init(&bench_held[i], WAKE_LOCK_IDLE,
+			       "wakelock_bench_held");
+
+	for (n = 0; n < ARRAY_SIZE(bench_held_counts); n++) {
+		for (; held < bench_held_counts[n]; held++)
+			wake_lock_timeout(&bench_held[held], 60 * HZ);
+
+		pair_ns = wakelock_bench_run(1);
+		check_ns = wakelock_bench_run(0);
+		pr_info("wakelock benchmark: %2d held: %llu lock/unlock pairs/s, "
+			"%llu idle checks/s\n", held,
+			div64_u64((u64)BENCH_LOOPS * NSEC_PER_SEC, pair_ns),
+			div64_u64((u64)BENCH_LOOPS * NSEC_PER_SEC, check_ns));
+	}
+
+	for (i = 0; i < BENCH_MAX_HELD; i++) {
+		wake_unlock(&bench_held[i]);
+		wake_lock_destroy(&bench_held[i]);
+	}
+	wake_lock_destroy(&bench_lock);
+	return 0;
+}
+late_initcall(wakelock_benchmark);
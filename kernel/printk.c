@@ -33,6 +33,12 @@
 #include <linux/bootmem.h>
 #include <linux/syscalls.h>
 #include <linux/kexec.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/notifier.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/uaccess.h>
 
@@ -157,8 +163,19 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/* printk_pending bits, acted on from printk_tick() */
+#define PRINTK_PENDING_WAKEUP	0x01	/* wake up syslog readers */
+#define PRINTK_PENDING_CONSOLE	0x02	/* wake up console_task */
+static DEFINE_PER_CPU(int, printk_pending);
+
 #ifdef CONFIG_PRINTK
 
+/*
+ * Thread that pushes log_buf out to the consoles on behalf of printk().
+ * Until it is running, printk() flushes to the consoles itself.
+ */
+static struct task_struct *console_task;
+
 static char __log_buf[__LOG_BUF_LEN];
 static char *log_buf = __log_buf;
 static int log_buf_len = __LOG_BUF_LEN;
@@ -743,8 +760,22 @@ asmlinkage int printk(const char *fmt, ...)
 	return r;
 }
 
-/* cpu currently holding logbuf_lock */
-static volatile unsigned int printk_cpu = UINT_MAX;
+/* Set while this cpu is inside vprintk(), to catch recursion */
+static DEFINE_PER_CPU(int, printk_in_progress);
+
+/*
+ * Leave console output to console_task, unless we are booting, going
+ * down, oopsing or panicking, or were asked not to on the command line
+ * (printk.synchronous=1).
+ */
+static int printk_synchronous;
+module_param_named(synchronous, printk_synchronous, bool, S_IRUGO | S_IWUSR);
+
+static inline int printk_sync_console(void)
+{
+	return printk_synchronous || oops_in_progress || !console_task ||
+		system_state != SYSTEM_RUNNING;
+}
 
 /*
  * Can we actually use the console at this time on this cpu?
@@ -788,7 +819,7 @@ static int acquire_console_semaphore_for_printk(unsigned int cpu)
 			retval = 0;
 		}
 	}
-	printk_cpu = UINT_MAX;
+	per_cpu(printk_in_progress, cpu) = 0;
 	spin_unlock(&logbuf_lock);
 	return retval;
 }
@@ -796,7 +827,35 @@ static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
 static int new_text_line = 1;
-static char printk_buf[1024];
+
+#define PRINTK_BUF_SIZE	1024
+static DEFINE_PER_CPU(char [PRINTK_BUF_SIZE], printk_buf);
+
+/*
+ * Time spent in vprintk() with interrupts off, split by whether the
+ * caller was in interrupt context. Read or reset through debugfs.
+ */
+enum { PRINTK_STAT_TASK, PRINTK_STAT_IRQ, PRINTK_STAT_NR };
+
+struct printk_stat {
+	unsigned long		count;
+	unsigned long long	total_ns;
+	unsigned long long	max_ns;
+};
+
+static DEFINE_PER_CPU(struct printk_stat [PRINTK_STAT_NR], printk_stats);
+
+static inline void printk_account(int cpu, unsigned long long ns)
+{
+	struct printk_stat *st;
+
+	st = &per_cpu(printk_stats, cpu)[in_interrupt() ?
+				PRINTK_STAT_IRQ : PRINTK_STAT_TASK];
+	st->count++;
+	st->total_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+}
 
 int printk_delay_msec __read_mostly;
 
@@ -816,9 +875,11 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 {
 	int printed_len = 0;
 	int current_log_level = default_message_loglevel;
+	int need_newline = 0;
 	unsigned long flags;
+	unsigned long long t0;
 	int this_cpu;
-	char *p;
+	char *buf, *p;
 
 	boot_delay_msec();
 	printk_delay();
@@ -827,11 +888,12 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	/* This stops the holder of console_sem just where we want him */
 	raw_local_irq_save(flags);
 	this_cpu = smp_processor_id();
+	t0 = cpu_clock(this_cpu);
 
 	/*
 	 * Ouch, printk recursed into itself!
 	 */
-	if (unlikely(printk_cpu == this_cpu)) {
+	if (unlikely(per_cpu(printk_in_progress, this_cpu))) {
 		/*
 		 * If a crash is occurring during printk() on this CPU,
 		 * then try to get the crash message out but make sure
@@ -847,23 +909,28 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	}
 
 	lockdep_off();
-	spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
+	per_cpu(printk_in_progress, this_cpu) = 1;
 
+	/*
+	 * Format the message into this cpu's buffer before taking
+	 * logbuf_lock, so that the lock only covers the copy into log_buf.
+	 * Interrupts are off, so nothing else can use the buffer meanwhile.
+	 */
+	buf = per_cpu(printk_buf, this_cpu);
 	if (recursion_bug) {
 		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
+		strcpy(buf, recursion_bug_msg);
 		printed_len = strlen(recursion_bug_msg);
 	}
 	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
+	printed_len += vscnprintf(buf + printed_len,
+				  PRINTK_BUF_SIZE - printed_len, fmt, args);
 
 #ifdef	CONFIG_DEBUG_LL
-	printascii(printk_buf);
+	printascii(buf);
 #endif
 
-	p = printk_buf;
+	p = buf;
 
 	/* Do we have a loglevel in the string? */
 	if (p[0] == '<') {
@@ -874,10 +941,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				current_log_level = c - '0';
 			/* Fallthrough - make sure we're on a new line */
 			case 'd': /* KERN_DEFAULT */
-				if (!new_text_line) {
-					emit_log_char('\n');
-					new_text_line = 1;
-				}
+				need_newline = 1;
 			/* Fallthrough - skip the loglevel */
 			case 'c': /* KERN_CONT */
 				p += 3;
@@ -886,6 +950,13 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		}
 	}
 
+	spin_lock(&logbuf_lock);
+
+	if (need_newline && !new_text_line) {
+		emit_log_char('\n');
+		new_text_line = 1;
+	}
+
 	/*
 	 * Copy the output into log_buf.  If the caller didn't provide
 	 * appropriate log level tags, we insert them here
@@ -906,7 +977,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				unsigned long long t;
 				unsigned long nanosec_rem;
 
-				t = cpu_clock(printk_cpu);
+				t = cpu_clock(this_cpu);
 				nanosec_rem = do_div(t, 1000000000);
 				tlen = sprintf(tbuf, "[%5lu.%06lu] ",
 						(unsigned long) t,
@@ -926,24 +997,36 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 			new_text_line = 1;
 	}
 
-	/*
-	 * Try to acquire and then immediately release the
-	 * console semaphore. The release will do all the
-	 * actual magic (print out buffers, wake up klogd,
-	 * etc). 
-	 *
-	 * The acquire_console_semaphore_for_printk() function
-	 * will release 'logbuf_lock' regardless of whether it
-	 * actually gets the semaphore or not.
-	 */
-	if (acquire_console_semaphore_for_printk(this_cpu))
-		release_console_sem();
+	if (printk_sync_console()) {
+		/*
+		 * Try to acquire and then immediately release the
+		 * console semaphore. The release will do all the
+		 * actual magic (print out buffers, wake up klogd,
+		 * etc).
+		 *
+		 * The acquire_console_semaphore_for_printk() function
+		 * will release 'logbuf_lock' regardless of whether it
+		 * actually gets the semaphore or not.
+		 */
+		if (acquire_console_semaphore_for_printk(this_cpu))
+			release_console_sem();
+	} else {
+		/*
+		 * Leave the console drivers to console_task. We may be
+		 * called with scheduler locks held, so it is woken from
+		 * the next tick rather than from here.
+		 */
+		per_cpu(printk_in_progress, this_cpu) = 0;
+		spin_unlock(&logbuf_lock);
+		__raw_get_cpu_var(printk_pending) |= PRINTK_PENDING_CONSOLE;
+	}
 	/* ++ FIHTDC Div2-SW2-BSP AlbertYCFang 2010.08.31 ++ */
 #if defined(CONFIG_FIH_FLOG)
     wake_up_interruptible(&log_ftm_wait);
 #endif
 	/* -- FIHTDC Div2-SW2-BSP AlbertYCFang 2010.08.31 -- */
 
+	printk_account(this_cpu, cpu_clock(this_cpu) - t0);
 	lockdep_on();
 out_restore_irqs:
 	raw_local_irq_restore(flags);
@@ -1164,13 +1247,18 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
-	if (__get_cpu_var(printk_pending)) {
+	int pending = __get_cpu_var(printk_pending);
+
+	if (pending) {
 		__get_cpu_var(printk_pending) = 0;
-		wake_up_interruptible(&log_wait);
+#ifdef CONFIG_PRINTK
+		if (pending & PRINTK_PENDING_CONSOLE)
+			wake_up_process(console_task);
+#endif
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1181,8 +1269,14 @@ int printk_needs_cpu(int cpu)
 
 void wake_up_klogd(void)
 {
-	if (waitqueue_active(&log_wait))
-		__raw_get_cpu_var(printk_pending) = 1;
+	unsigned long flags;
+
+	if (waitqueue_active(&log_wait)) {
+		/* printk() may set PRINTK_PENDING_CONSOLE from an interrupt */
+		local_irq_save(flags);
+		__raw_get_cpu_var(printk_pending) |= PRINTK_PENDING_WAKEUP;
+		local_irq_restore(flags);
+	}
 }
 
 /**
@@ -1566,4 +1660,115 @@ bool printk_timed_ratelimit(unsigned long *caller_jiffies,
 	return false;
 }
 EXPORT_SYMBOL(printk_timed_ratelimit);
+
+static int printk_console_thread(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (con_start == log_end || console_suspended)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		acquire_console_sem();
+		release_console_sem();
+	}
+	return 0;
+}
+
+/* Once we have panicked, console_task may never run again */
+static int printk_panic_event(struct notifier_block *this,
+			      unsigned long event, void *ptr)
+{
+	printk_synchronous = 1;
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block printk_panic_block = {
+	.notifier_call	= printk_panic_event,
+	.priority	= INT_MAX,
+};
+
+static int __init printk_console_thread_init(void)
+{
+	struct task_struct *p;
+
+	atomic_notifier_chain_register(&panic_notifier_list,
+				       &printk_panic_block);
+
+	p = kthread_run(printk_console_thread, NULL, "kconsole");
+	if (IS_ERR(p)) {
+		printk(KERN_ERR "printk: cannot start console thread, "
+			"flushing synchronously\n");
+		return PTR_ERR(p);
+	}
+	console_task = p;
+	return 0;
+}
+core_initcall(printk_console_thread_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int printk_stats_show(struct seq_file *m, void *unused)
+{
+	static const char *names[PRINTK_STAT_NR] = { "task", "irq" };
+	struct printk_stat sum;
+	int cpu, i;
+
+	seq_printf(m, "console: %s\n",
+		   printk_sync_console() ? "synchronous" : "deferred");
+
+	for (i = 0; i < PRINTK_STAT_NR; i++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct printk_stat *st = &per_cpu(printk_stats, cpu)[i];
+
+			sum.count += st->count;
+			sum.total_ns += st->total_ns;
+			if (st->max_ns > sum.max_ns)
+				sum.max_ns = st->max_ns;
+		}
+		if (sum.count)
+			do_div(sum.total_ns, sum.count);
+		seq_printf(m, "%-5s calls %lu avg_ns %llu max_ns %llu\n",
+			   names[i], sum.count, sum.total_ns, sum.max_ns);
+	}
+	return 0;
+}
+
+static int printk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, printk_stats_show, NULL);
+}
+
+/* Any write resets the counters */
+static ssize_t printk_stats_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		local_irq_save(flags);
+		memset(per_cpu(printk_stats, cpu), 0,
+		       sizeof(per_cpu(printk_stats, cpu)));
+		local_irq_restore(flags);
+	}
+	return count;
+}
+
+static const struct file_operations printk_stats_fops = {
+	.open		= printk_stats_open,
+	.read		= seq_read,
+	.write		= printk_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init printk_stats_init(void)
+{
+	debugfs_create_file("printk_stats", 0644, NULL, NULL,
+			    &printk_stats_fops);
+	return 0;
+}
+late_initcall(printk_stats_init);
+#endif /* CONFIG_DEBUG_FS */
 #endif
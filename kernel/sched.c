@@ -76,6 +76,7 @@
 #include <asm/irq_regs.h>
 
 #include "sched_cpupri.h"
+#include "workqueue_sched.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/sched.h>
@@ -407,6 +408,11 @@ struct cfs_rq {
 
 	unsigned int nr_spread_over;
 
+#ifdef CONFIG_SMP
+	/* utilization of the cpu by CFS tasks, kept on the root cfs_rq */
+	struct sched_avg avg;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct rq *rq;	/* cpu runqueue to which this cfs_rq is attached */
 
@@ -2502,6 +2508,9 @@ static void __sched_fork(struct task_struct *p)
 	p->se.start_runtime		= 0;
 	p->se.avg_wakeup		= sysctl_sched_wakeup_granularity;
 	p->se.avg_running		= 0;
+#ifdef CONFIG_SMP
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+#endif
 
 #ifdef CONFIG_SCHEDSTATS
 	p->se.wait_start			= 0;
@@ -3208,6 +3217,9 @@ int can_migrate_task(struct task_struct *p, struct rq *rq, int this_cpu,
 		return 0;
 	}
 
+	if (task_stays_packed(p, rq))
+		return 0;
+
 	/*
 	 * Aggressive migration if:
 	 * 1) task is cache cold, or
@@ -5429,11 +5441,24 @@ pick_next_task(struct rq *rq)
  */
 asmlinkage void __sched schedule(void)
 {
+	struct task_struct *tsk = current;
 	struct task_struct *prev, *next;
 	unsigned long *switch_count;
 	struct rq *rq;
 	int cpu;
 
+	/*
+	 * A pool worker about to block may have to hand the pending work
+	 * to another worker. Let the pool know now, while no rq lock is
+	 * held and it can still wake one up.
+	 */
+	if (unlikely(tsk->flags & PF_WQ_WORKER) && tsk->state &&
+	    !(preempt_count() & PREEMPT_ACTIVE)) {
+		preempt_disable();
+		wq_worker_sleeping(tsk);
+		preempt_enable_no_resched();
+	}
+
 need_resched:
 	preempt_disable();
 	cpu = smp_processor_id();
@@ -5496,6 +5521,9 @@ need_resched_nonpreemptible:
 	preempt_enable_no_resched();
 	if (need_resched())
 		goto need_resched;
+
+	if (unlikely(tsk->flags & PF_WQ_WORKER))
+		wq_worker_running(tsk);
 }
 EXPORT_SYMBOL(schedule);
 
@@ -76,6 +76,18 @@ unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
+#ifdef CONFIG_SMP
+/*
+ * Small task packing: wake a task that has recently used less than
+ * sched_small_task_pct of a cpu on the first active cpu it may run on,
+ * as long as that cpu stays below sched_pack_cpu_pct with it. The other
+ * cpus then stay in deep idle, or can be unplugged.
+ */
+unsigned int sysctl_sched_pack_small_tasks __read_mostly;
+unsigned int sysctl_sched_small_task_pct __read_mostly = 20;
+unsigned int sysctl_sched_pack_cpu_pct __read_mostly = 80;
+#endif
+
 static const struct sched_class fair_sched_class;
 
 /**************************************************************
@@ -473,6 +485,164 @@ static u64 sched_vslice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	return calc_delta_fair(sched_slice(cfs_rq, se), se);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking. Time is counted in units of 1024ns and in
+ * periods of 1024 units; each period weighs y times the next one, with
+ * y^LOAD_AVG_PERIOD = 1/2, so what a task did 32ms ago counts half as
+ * much as what it does now.
+ */
+#define LOAD_AVG_PERIOD	32
+#define LOAD_AVG_MAX	47742	/* maximum possible sum */
+#define LOAD_AVG_MAX_N	345	/* number of full periods to reach it */
+
+/* y^n * 2^32, for n < LOAD_AVG_PERIOD */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b, 0xeac0c6e7, 0xe5b906e7,
+	0xe0ccdeec, 0xdbfbb797, 0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47, 0xb504f333, 0xb123f581,
+	0xad583eea, 0xa9a15ab4, 0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+	0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/* \Sum 1024 * y^k for k = 1..n, for n <= LOAD_AVG_PERIOD */
+static const u32 runnable_avg_yN_sum[] = {
+	0, 1002, 1982, 2942, 3881, 4800, 5699, 6579, 7440, 8282, 9107,
+	9914, 10704, 11476, 12232, 12972, 13696, 14405, 15098, 15777, 16441, 17091,
+	17726, 18349, 18957, 19553, 20136, 20707, 21265, 21812, 22346, 22870, 23382,
+};
+
+static u32 decay_load(u32 val, u32 n)
+{
+	if (!n)
+		return val;
+	/* val is 32 bits wide, so 32 halvings leave nothing of it */
+	if (n >= LOAD_AVG_PERIOD * 32)
+		return 0;
+
+	if (n >= LOAD_AVG_PERIOD) {
+		val >>= n / LOAD_AVG_PERIOD;
+		n %= LOAD_AVG_PERIOD;
+	}
+	return ((u64)val * runnable_avg_yN_inv[n]) >> 32;
+}
+
+/* What n full periods contribute: \Sum 1024 * y^k for k = 1..n */
+static u32 __compute_runnable_contrib(u32 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	else if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	do {
+		contrib /= 2;		/* y^LOAD_AVG_PERIOD = 1/2 */
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+		n -= LOAD_AVG_PERIOD;
+	} while (n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, n);
+	return contrib + runnable_avg_yN_sum[n];
+}
+
+/*
+ * Account the time since the last update as running or not: finish the
+ * period in progress, decay everything by the periods that have passed
+ * and add the full periods in between, then start the current one.
+ */
+static void __update_sched_avg(u64 now, struct sched_avg *sa, int running)
+{
+	u64 delta;
+	u32 delta_w, periods, contrib;
+
+	delta = now - sa->last_update;
+	/* The clocks of two cpus can be a little apart after a migration */
+	if ((s64)delta < 0 || !sa->last_update) {
+		sa->last_update = now;
+		return;
+	}
+	delta >>= 10;
+	if (!delta)
+		return;
+	sa->last_update = now;
+
+	delta_w = sa->period_sum % 1024;
+	if (delta + delta_w >= 1024) {
+		delta_w = 1024 - delta_w;
+		if (running)
+			sa->running_sum += delta_w;
+		sa->period_sum += delta_w;
+		delta -= delta_w;
+
+		periods = min_t(u64, delta >> 10, LOAD_AVG_PERIOD * 63);
+		delta &= 1023;
+
+		sa->running_sum = decay_load(sa->running_sum, periods + 1);
+		sa->period_sum = decay_load(sa->period_sum, periods + 1);
+
+		contrib = __compute_runnable_contrib(periods);
+		if (running)
+			sa->running_sum += contrib;
+		sa->period_sum += contrib;
+	}
+
+	if (running)
+		sa->running_sum += delta;
+	sa->period_sum += delta;
+}
+
+/* Recent utilization, out of SCHED_LOAD_SCALE */
+static inline unsigned int sched_avg_util(struct sched_avg *sa)
+{
+	return (sa->running_sum << SCHED_LOAD_SHIFT) / (sa->period_sum + 1);
+}
+
+static inline void
+update_entity_util(struct cfs_rq *cfs_rq, struct sched_entity *se, int running)
+{
+	if (entity_is_task(se))
+		__update_sched_avg(rq_of(cfs_rq)->clock, &se->avg, running);
+}
+
+static inline void update_cpu_util(struct cfs_rq *cfs_rq, int running)
+{
+	struct rq *rq = rq_of(cfs_rq);
+
+	if (cfs_rq == &rq->cfs)
+		__update_sched_avg(rq->clock, &rq->cfs.avg, running);
+}
+
+/**
+ * sched_cpu_util - recent utilization of a cpu by CFS tasks
+ * @cpu: the cpu in question
+ *
+ * Returns a value out of SCHED_LOAD_SCALE, decayed up to now even if the
+ * cpu has been idle since it last scheduled. Lockless and approximate,
+ * for policies such as cpu hotplug to base decisions on.
+ */
+unsigned int sched_cpu_util(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct sched_avg sa = rq->cfs.avg;
+
+	__update_sched_avg(sched_clock_cpu(cpu), &sa, rq->cfs.curr != NULL);
+	return sched_avg_util(&sa);
+}
+EXPORT_SYMBOL_GPL(sched_cpu_util);
+#else
+static inline void
+update_entity_util(struct cfs_rq *cfs_rq, struct sched_entity *se, int running)
+{
+}
+
+static inline void update_cpu_util(struct cfs_rq *cfs_rq, int running)
+{
+}
+#endif /* CONFIG_SMP */
+
 /*
  * Update the current task's runtime statistics. Skip current tasks that
  * are not in our scheduling class.
@@ -512,6 +682,8 @@ static void update_curr(struct cfs_rq *cfs_rq)
 
 	__update_curr(cfs_rq, curr, delta_exec);
 	curr->exec_start = now;
+	update_entity_util(cfs_rq, curr, 1);
+	update_cpu_util(cfs_rq, 1);
 
 	if (entity_is_task(curr)) {
 		struct task_struct *curtask = task_of(curr);
@@ -755,6 +927,7 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int wakeup)
 	if (wakeup) {
 		place_entity(cfs_rq, se, 0);
 		enqueue_sleeper(cfs_rq, se);
+		update_entity_util(cfs_rq, se, 0);
 	}
 
 	update_stats_enqueue(cfs_rq, se);
@@ -862,6 +1035,10 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		__dequeue_entity(cfs_rq, se);
 	}
 
+	/* It was waiting, and the cpu was not running CFS tasks */
+	update_entity_util(cfs_rq, se, 0);
+	update_cpu_util(cfs_rq, 0);
+
 	update_stats_curr_start(cfs_rq, se);
 	cfs_rq->curr = se;
 #ifdef CONFIG_SCHEDSTATS
@@ -1347,6 +1524,69 @@ find_idlest_cpu(struct sched_group *group, struct task_struct *p, int this_cpu)
 	return idlest;
 }
 
+/*
+ * A task's utilization decayed up to now. It is not running, so the
+ * time since it last ran on its cpu counts as idle.
+ */
+static unsigned int task_util(struct task_struct *p)
+{
+	struct sched_avg sa = p->se.avg;
+
+	__update_sched_avg(sched_clock_cpu(task_cpu(p)), &sa, 0);
+	return sched_avg_util(&sa);
+}
+
+static int task_is_small(struct task_struct *p)
+{
+	return task_util(p) * 100 <=
+		sysctl_sched_small_task_pct * SCHED_LOAD_SCALE;
+}
+
+static int packing_cpu(struct task_struct *p)
+{
+	int cpu = cpumask_first_and(&p->cpus_allowed, cpu_active_mask);
+
+	return cpu < nr_cpu_ids ? cpu : -1;
+}
+
+/*
+ * The cpu to wake a small task on, or -1 to place it as usual. The
+ * task's own utilization is only added when it last ran elsewhere.
+ */
+static int select_packing_cpu(struct task_struct *p)
+{
+	unsigned int util = 0;
+	int cpu;
+
+	if (!task_is_small(p))
+		return -1;
+
+	cpu = packing_cpu(p);
+	if (cpu < 0)
+		return -1;
+
+	if (task_cpu(p) != cpu)
+		util = task_util(p);
+	if ((sched_cpu_util(cpu) + util) * 100 >
+	    sysctl_sched_pack_cpu_pct * SCHED_LOAD_SCALE)
+		return -1;
+
+	return cpu;
+}
+
+/*
+ * Whether the load balancer should leave a task where packing put it.
+ */
+static int task_stays_packed(struct task_struct *p, struct rq *rq)
+{
+	if (!sysctl_sched_pack_small_tasks)
+		return 0;
+
+	return cpu_of(rq) == packing_cpu(p) && task_is_small(p) &&
+	       sched_cpu_util(cpu_of(rq)) * 100 <=
+			sysctl_sched_pack_cpu_pct * SCHED_LOAD_SCALE;
+}
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -1368,6 +1608,13 @@ static int select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flag
 	int want_sd = 1;
 	int sync = wake_flags & WF_SYNC;
 
+	if ((sd_flag & SD_BALANCE_WAKE) && sysctl_sched_pack_small_tasks) {
+		new_cpu = select_packing_cpu(p);
+		if (new_cpu >= 0)
+			return new_cpu;
+		new_cpu = cpu;
+	}
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		if (sched_feat(AFFINE_WAKEUPS) &&
 		    cpumask_test_cpu(cpu, &p->cpus_allowed))
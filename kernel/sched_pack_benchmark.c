@@ -0,0 +1,104 @@
+/*
+ * kernel/sched_pack_benchmark.c - small task packing benchmark.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/delay.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+
+/*
+ * Run BENCH_TASKS threads that each busy-loop for BENCH_BUSY_US and then
+ * sleep for BENCH_SLEEP_MS, the pattern of background sync and media
+ * threads, for BENCH_SECS with small task packing off and then on. For
+ * each cpu, report how often it stopped its tick to go idle and the
+ * share of the run it spent idle: the time the platform could spend in
+ * power collapse. The benchmark runs in its own thread so that it does
+ * not hold up boot; results go to the kernel log.
+ */
+#define BENCH_TASKS		4
+#define BENCH_SECS		10
+#define BENCH_BUSY_US		500
+#define BENCH_SLEEP_MS		20
+
+struct bench_sample {
+	unsigned long idle_sleeps;
+	u64 idle_us;
+};
+
+static struct bench_sample bench_before[NR_CPUS], bench_after[NR_CPUS];
+
+static int sched_pack_bench_task(void *unused)
+{
+	while (!kthread_should_stop()) {
+		udelay(BENCH_BUSY_US);
+		msleep(BENCH_SLEEP_MS);
+	}
+	return 0;
+}
+
+static void sched_pack_bench_sample(struct bench_sample *s)
+{
+	u64 now;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		s[cpu].idle_sleeps = tick_get_tick_sched(cpu)->idle_sleeps;
+		s[cpu].idle_us = get_cpu_idle_time_us(cpu, &now);
+	}
+}
+
+static void sched_pack_bench_run(unsigned int pack)
+{
+	struct task_struct *tasks[BENCH_TASKS];
+	u64 idle_us;
+	int i, cpu;
+
+	sysctl_sched_pack_small_tasks = pack;
+
+	sched_pack_bench_sample(bench_before);
+	for (i = 0; i < BENCH_TASKS; i++)
+		tasks[i] = kthread_run(sched_pack_bench_task, NULL,
+				       "packbench/%d", i);
+	msleep(BENCH_SECS * MSEC_PER_SEC);
+	for (i = 0; i < BENCH_TASKS; i++)
+		if (!IS_ERR(tasks[i]))
+			kthread_stop(tasks[i]);
+	sched_pack_bench_sample(bench_after);
+
+	for_each_online_cpu(cpu) {
+		idle_us = bench_after[cpu].idle_us - bench_before[cpu].idle_us;
+		pr_info("sched_pack_benchmark: packing %s, cpu%d: "
+			"%lu idle entries/s, %llu%% idle\n",
+			pack ? "on" : "off", cpu,
+			(bench_after[cpu].idle_sleeps -
+			 bench_before[cpu].idle_sleeps) / BENCH_SECS,
+			div_u64(idle_us * 100, BENCH_SECS * USEC_PER_SEC));
+	}
+}
+
+static int sched_pack_benchmark(void *unused)
+{
+	unsigned int saved = sysctl_sched_pack_small_tasks;
+
+	sched_pack_bench_run(0);
+	sched_pack_bench_run(1);
+	sysctl_sched_pack_small_tasks = saved;
+
+	return 0;
+}
+
+static int __init sched_pack_benchmark_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(sched_pack_benchmark, NULL, "packbench");
+	return IS_ERR(t) ? PTR_ERR(t) : 0;
+}
+late_initcall(sched_pack_benchmark_init);
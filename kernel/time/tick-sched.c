@@ -564,6 +564,18 @@ ktime_t tick_nohz_get_sleep_length(void)
 	return ts->sleep_length;
 }
 
+/**
+ * tick_nohz_in_idle - tell whether this cpu is in its idle loop
+ *
+ * True from the idle loop stopping the tick until it restarts it, which
+ * includes the interrupts and softirqs that run on the way out of idle.
+ * Called with interrupts disabled.
+ */
+int tick_nohz_in_idle(void)
+{
+	return __get_cpu_var(tick_cpu_sched).inidle;
+}
+
 static void tick_nohz_restart(struct tick_sched *ts, ktime_t now)
 {
 	hrtimer_cancel(&ts->sched_timer);
@@ -31,6 +31,10 @@
  * Display the information collected so far:
  * # cat /proc/timer_stats
  *
+ * Display, of the same sample, the timers that expired while their CPU
+ * was idle - the ones still waking it up:
+ * # cat /proc/timer_wakeups
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
  * published by the Free Software Foundation.
@@ -42,6 +46,7 @@
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/kallsyms.h>
+#include <linux/tick.h>
 
 #include <asm/uaccess.h>
 
@@ -70,6 +75,11 @@ struct entry {
 	unsigned long		count;
 	unsigned int		timer_flag;
 
+	/*
+	 * Number of those that expired in idle, without being deferrable:
+	 */
+	unsigned long		wakeups;
+
 	/*
 	 * We save the command-line string to preserve
 	 * this information past task exit:
@@ -204,6 +214,7 @@ static struct entry *tstat_lookup(struct entry *entry, char *comm)
 	if (curr) {
 		*curr = *entry;
 		curr->count = 0;
+		curr->wakeups = 0;
 		curr->next = NULL;
 		memcpy(curr->comm, comm, TASK_COMM_LEN);
 
@@ -251,16 +262,21 @@ void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
 	input.start_func = startf;
 	input.expire_func = timerf;
 	input.pid = pid;
-	input.timer_flag = timer_flag;
+	input.timer_flag = timer_flag & ~TIMER_STATS_FLAG_WAKEUP;
 
 	spin_lock_irqsave(lock, flags);
 	if (!timer_stats_active)
 		goto out_unlock;
 
+	if (!(timer_flag & TIMER_STATS_FLAG_DEFERRABLE) && tick_nohz_in_idle())
+		timer_flag |= TIMER_STATS_FLAG_WAKEUP;
+
 	entry = tstat_lookup(&input, comm);
-	if (likely(entry))
+	if (likely(entry)) {
 		entry->count++;
-	else
+		if (timer_flag & TIMER_STATS_FLAG_WAKEUP)
+			entry->wakeups++;
+	} else
 		atomic_inc(&overflow_count);
 
  out_unlock:
@@ -277,11 +293,11 @@ static void print_name_offset(struct seq_file *m, unsigned long addr)
 		seq_printf(m, "%s", symname);
 }
 
-static int tstats_show(struct seq_file *m, void *v)
+static int __tstats_show(struct seq_file *m, int wakeups)
 {
 	struct timespec period;
 	struct entry *entry;
-	unsigned long ms;
+	unsigned long ms, count;
 	long events = 0;
 	ktime_t time;
 	int i;
@@ -298,7 +314,10 @@ static int tstats_show(struct seq_file *m, void *v)
 	period = ktime_to_timespec(time);
 	ms = period.tv_nsec / 1000000;
 
-	seq_puts(m, "Timer Stats Version: v0.2\n");
+	if (wakeups)
+		seq_puts(m, "Timer Wakeups Version: v0.1\n");
+	else
+		seq_puts(m, "Timer Stats Version: v0.2\n");
 	seq_printf(m, "Sample period: %ld.%03ld s\n", period.tv_sec, ms);
 	if (atomic_read(&overflow_count))
 		seq_printf(m, "Overflow: %d entries\n",
@@ -306,12 +325,15 @@ static int tstats_show(struct seq_file *m, void *v)
 
 	for (i = 0; i < nr_entries; i++) {
 		entry = entries + i;
+		count = wakeups ? entry->wakeups : entry->count;
+		if (!count)
+			continue;
  		if (entry->timer_flag & TIMER_STATS_FLAG_DEFERRABLE) {
 			seq_printf(m, "%4luD, %5d %-16s ",
-				entry->count, entry->pid, entry->comm);
+				count, entry->pid, entry->comm);
 		} else {
 			seq_printf(m, " %4lu, %5d %-16s ",
-				entry->count, entry->pid, entry->comm);
+				count, entry->pid, entry->comm);
 		}
 
 		print_name_offset(m, (unsigned long)entry->start_func);
@@ -319,7 +341,7 @@ static int tstats_show(struct seq_file *m, void *v)
 		print_name_offset(m, (unsigned long)entry->expire_func);
 		seq_puts(m, ")\n");
 
-		events += entry->count;
+		events += count;
 	}
 
 	ms += period.tv_sec * 1000;
@@ -327,17 +349,24 @@ static int tstats_show(struct seq_file *m, void *v)
 		ms = 1;
 
 	if (events && period.tv_sec)
-		seq_printf(m, "%ld total events, %ld.%03ld events/sec\n",
-			   events, events * 1000 / ms,
-			   (events * 1000000 / ms) % 1000);
+		seq_printf(m, "%ld total %s, %ld.%03ld %s/sec\n",
+			   events, wakeups ? "wakeups" : "events",
+			   events * 1000 / ms, (events * 1000000 / ms) % 1000,
+			   wakeups ? "wakeups" : "events");
 	else
-		seq_printf(m, "%ld total events\n", events);
+		seq_printf(m, "%ld total %s\n", events,
+			   wakeups ? "wakeups" : "events");
 
 	mutex_unlock(&show_mutex);
 
 	return 0;
 }
 
+static int tstats_show(struct seq_file *m, void *v)
+{
+	return __tstats_show(m, 0);
+}
+
 /*
  * After a state change, make sure all concurrent lookup/update
  * activities have stopped:
@@ -403,6 +432,23 @@ static const struct file_operations tstats_fops = {
 	.release	= single_release,
 };
 
+static int twakeups_show(struct seq_file *m, void *v)
+{
+	return __tstats_show(m, 1);
+}
+
+static int twakeups_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, twakeups_show, NULL);
+}
+
+static const struct file_operations twakeups_fops = {
+	.open		= twakeups_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void __init init_timer_stats(void)
 {
 	int cpu;
@@ -416,6 +462,9 @@ static int __init init_tstats_procfs(void)
 	struct proc_dir_entry *pe;
 
 	pe = proc_create("timer_stats", 0644, NULL, &tstats_fops);
+	if (!pe)
+		return -ENOMEM;
+	pe = proc_create("timer_wakeups", 0444, NULL, &twakeups_fops);
 	if (!pe)
 		return -ENOMEM;
 	return 0;
@@ -30,9 +30,13 @@
 #include <linux/hardirq.h>
 #include <linux/mempolicy.h>
 #include <linux/freezer.h>
+#include <linux/delay.h>
 #include <linux/kallsyms.h>
 #include <linux/debug_locks.h>
 #include <linux/lockdep.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #define CREATE_TRACE_POINTS
 #include <trace/events/workqueue.h>
 
@@ -50,6 +54,17 @@ struct cpu_workqueue_struct {
 
 	struct workqueue_struct *wq;
 	struct task_struct *thread;
+
+	struct worker *worker;		/* pool worker running us */
+	struct list_head pool_entry;	/* on worker_pool.pending */
+
+#ifdef CONFIG_WORKQUEUE_STATS
+	unsigned long executed;
+	u64 exec_ns;
+	u64 max_exec_ns;
+	u64 latency_ns;
+	u64 max_latency_ns;
+#endif
 } ____cacheline_aligned;
 
 /*
@@ -63,15 +78,68 @@ struct workqueue_struct {
 	int singlethread;
 	int freezeable;		/* Freeze threads during suspend */
 	int rt;
+	int pooled;		/* Run by the worker pool, no thread */
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WORKQUEUE_STATS
+	struct list_head stats_list;
+#endif
+};
+
+/*
+ * Single threaded workqueues that are neither realtime, freezeable nor
+ * created for the reclaim path don't get a thread of their own: their
+ * work is run by a shared pool of workers. Normally one worker is busy
+ * and another waits in reserve. When a worker blocks in a work item
+ * while other workqueues have work pending, schedule() tells the pool
+ * and the reserve takes over, and replaces itself before it starts;
+ * spare workers exit after being idle for IDLE_WORKER_TIMEOUT. Creating
+ * a worker allocates memory, so work that reclaim may wait on keeps a
+ * thread of its own, see create_reclaim_workqueue(). A workqueue is run
+ * by only one worker at a time, so its work items are still executed in
+ * order, one at a time.
+ */
+struct worker_pool {
+	spinlock_t lock;
+	struct list_head pending;	/* cwqs with work and no worker */
+	struct list_head idle;		/* idle workers, most recent first */
+	int nr_workers;
+	int nr_idle;
+	int nr_running;			/* busy workers that aren't blocked */
+	int creating;			/* a reserve worker is being created */
+	int next_id;
+	unsigned long handoffs;		/* wakeups because a worker blocked */
+};
+
+struct worker {
+	struct list_head entry;		/* on worker_pool.idle */
+	struct task_struct *task;
+	struct cpu_workqueue_struct *cwq;	/* cwq being run */
+	unsigned int flags;
+};
+
+#define WORKER_IDLE		0x1	/* on worker_pool.idle */
+#define WORKER_SLEEPING		0x2	/* blocked in a work item */
+
+#define MAX_IDLE_WORKERS	2
+#define IDLE_WORKER_TIMEOUT	(300 * HZ)
+
+static struct worker_pool worker_pool = {
+	.lock		= __SPIN_LOCK_UNLOCKED(worker_pool.lock),
+	.pending	= LIST_HEAD_INIT(worker_pool.pending),
+	.idle		= LIST_HEAD_INIT(worker_pool.idle),
 };
 
 /* Serializes the accesses to the list of workqueues. */
 static DEFINE_SPINLOCK(workqueue_lock);
 static LIST_HEAD(workqueues);
 
+#ifdef CONFIG_WORKQUEUE_STATS
+/* All workqueues, for the statistics in debugfs */
+static LIST_HEAD(stats_workqueues);
+#endif
+
 static int singlethread_cpu __read_mostly;
 static const struct cpumask *cpu_singlethread_map __read_mostly;
 /*
@@ -89,6 +157,11 @@ static inline int is_wq_single_threaded(struct workqueue_struct *wq)
 	return wq->singlethread;
 }
 
+static inline int is_wq_pooled(struct workqueue_struct *wq)
+{
+	return wq->pooled;
+}
+
 static const struct cpumask *wq_cpu_map(struct workqueue_struct *wq)
 {
 	return is_wq_single_threaded(wq)
@@ -125,19 +198,83 @@ struct cpu_workqueue_struct *get_wq_data(struct work_struct *work)
 	return (void *) (atomic_long_read(&work->data) & WORK_STRUCT_WQ_DATA_MASK);
 }
 
+/* Wake up the most recently idle worker; called with pool->lock held */
+static void wake_idle_worker(struct worker_pool *pool)
+{
+	struct worker *worker;
+
+	if (list_empty(&pool->idle))
+		return;
+
+	worker = list_first_entry(&pool->idle, struct worker, entry);
+	list_del_init(&worker->entry);
+	worker->flags &= ~WORKER_IDLE;
+	pool->nr_idle--;
+	pool->nr_running++;
+	wake_up_process(worker->task);
+}
+
+/*
+ * Called with cwq->lock held when work is queued on a pooled cwq: unless
+ * a worker is already on it, queue it on the pool and make sure there is
+ * a worker to run it.
+ */
+static void pool_queue_cwq(struct cpu_workqueue_struct *cwq)
+{
+	struct worker_pool *pool = &worker_pool;
+
+	spin_lock(&pool->lock);
+	if (!cwq->worker && list_empty(&cwq->pool_entry)) {
+		list_add_tail(&cwq->pool_entry, &pool->pending);
+		if (pool->nr_running < num_online_cpus())
+			wake_idle_worker(pool);
+	}
+	spin_unlock(&pool->lock);
+}
+
+/*
+ * Called with cwq->lock held after a pool worker ran a work item of @cwq.
+ * The worker gives @cwq up when it is empty, or puts it back at the end
+ * of the pending list when other workqueues are waiting. Returns 1 if
+ * @cwq was given up.
+ */
+static int pool_release_cwq(struct cpu_workqueue_struct *cwq)
+{
+	struct worker_pool *pool = &worker_pool;
+	int release;
+
+	spin_lock(&pool->lock);
+	release = list_empty(&cwq->worklist) || !list_empty(&pool->pending);
+	if (release) {
+		cwq->worker = NULL;
+		if (!list_empty(&cwq->worklist))
+			list_add_tail(&cwq->pool_entry, &pool->pending);
+	}
+	spin_unlock(&pool->lock);
+
+	return release;
+}
+
 static void insert_work(struct cpu_workqueue_struct *cwq,
 			struct work_struct *work, struct list_head *head)
 {
-	trace_workqueue_insertion(cwq->thread, work);
+	if (cwq->thread)
+		trace_workqueue_insertion(cwq->thread, work);
 
 	set_wq_data(work, cwq);
+#ifdef CONFIG_WORKQUEUE_STATS
+	work->queued_at = sched_clock();
+#endif
 	/*
 	 * Ensure that we get the right work->data if we see the
 	 * result of list_add() below, see try_to_grab_pending().
 	 */
 	smp_wmb();
 	list_add_tail(&work->entry, head);
-	wake_up(&cwq->more_work);
+	if (is_wq_pooled(cwq->wq))
+		pool_queue_cwq(cwq);
+	else
+		wake_up(&cwq->more_work);
 }
 
 static void __queue_work(struct cpu_workqueue_struct *cwq,
@@ -279,7 +416,12 @@ static void run_workqueue(struct cpu_workqueue_struct *cwq)
 		 */
 		struct lockdep_map lockdep_map = work->lockdep_map;
 #endif
-		trace_workqueue_execution(cwq->thread, work);
+#ifdef CONFIG_WORKQUEUE_STATS
+		u64 start = sched_clock();
+		s64 latency = start - work->queued_at;
+		u64 exec;
+#endif
+		trace_workqueue_execution(current, work);
 		cwq->current_work = work;
 		list_del_init(cwq->worklist.next);
 		spin_unlock_irq(&cwq->lock);
@@ -305,7 +447,22 @@ static void run_workqueue(struct cpu_workqueue_struct *cwq)
 
 		spin_lock_irq(&cwq->lock);
 		cwq->current_work = NULL;
+#ifdef CONFIG_WORKQUEUE_STATS
+		exec = sched_clock() - start;
+		if (latency < 0)
+			latency = 0;
+		cwq->executed++;
+		cwq->exec_ns += exec;
+		cwq->max_exec_ns = max(cwq->max_exec_ns, exec);
+		cwq->latency_ns += latency;
+		cwq->max_latency_ns = max_t(u64, cwq->max_latency_ns, latency);
+#endif
+		if (is_wq_pooled(cwq->wq) && pool_release_cwq(cwq))
+			goto out;
 	}
+	if (is_wq_pooled(cwq->wq))
+		pool_release_cwq(cwq);
+out:
 	spin_unlock_irq(&cwq->lock);
 }
 
@@ -336,6 +493,212 @@ static int worker_thread(void *__cwq)
 	return 0;
 }
 
+static int pool_worker_thread(void *__worker);
+
+/*
+ * Create a worker and put it on the idle list. The pool keeps one in
+ * reserve, so it is ready to be woken from schedule() when a busy worker
+ * blocks.
+ */
+static int create_pool_worker(void)
+{
+	struct worker_pool *pool = &worker_pool;
+	struct worker *worker;
+	struct task_struct *p;
+	int id;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL);
+	if (!worker)
+		return -ENOMEM;
+
+	spin_lock_irq(&pool->lock);
+	id = pool->next_id++;
+	spin_unlock_irq(&pool->lock);
+
+	p = kthread_create(pool_worker_thread, worker, "kworker/%d", id);
+	if (IS_ERR(p)) {
+		kfree(worker);
+		return PTR_ERR(p);
+	}
+	worker->task = p;
+	trace_workqueue_creation(p, singlethread_cpu);
+
+	spin_lock_irq(&pool->lock);
+	worker->flags = WORKER_IDLE;
+	list_add(&worker->entry, &pool->idle);
+	pool->nr_idle++;
+	pool->nr_workers++;
+	spin_unlock_irq(&pool->lock);
+
+	wake_up_process(p);
+	return 0;
+}
+
+/*
+ * Refill the reserve. Without it, a work item that blocks stalls all
+ * the pending ones behind it, so keep retrying with a growing delay
+ * while memory or pids are short, until a worker has been created, one
+ * has gone idle or nothing is pending any more.
+ */
+static void create_pool_reserve(void)
+{
+	struct worker_pool *pool = &worker_pool;
+	unsigned int delay = 1;
+	int err, done;
+
+	while ((err = create_pool_worker())) {
+		WARN_ONCE(1, "workqueue: cannot create pool worker: %d\n",
+			  err);
+		msleep(delay);
+		delay = min(delay * 2, 1000U);
+
+		spin_lock_irq(&pool->lock);
+		done = pool->nr_idle || list_empty(&pool->pending);
+		spin_unlock_irq(&pool->lock);
+		if (done)
+			break;
+	}
+}
+
+/*
+ * Wait on the idle list until wake_idle_worker() picks @worker. Called
+ * and returns with pool->lock held. Returns 0 if the worker has been
+ * idle for IDLE_WORKER_TIMEOUT while the pool had more than enough
+ * idle workers, and should exit.
+ */
+static int pool_worker_wait(struct worker *worker)
+{
+	struct worker_pool *pool = &worker_pool;
+	long timeout = MAX_SCHEDULE_TIMEOUT;
+
+	while (worker->flags & WORKER_IDLE) {
+		if (pool->nr_idle <= MAX_IDLE_WORKERS)
+			timeout = MAX_SCHEDULE_TIMEOUT;
+		else if (!timeout) {
+			list_del_init(&worker->entry);
+			pool->nr_idle--;
+			pool->nr_workers--;
+			return 0;
+		} else if (timeout == MAX_SCHEDULE_TIMEOUT)
+			timeout = IDLE_WORKER_TIMEOUT;
+
+		__set_current_state(TASK_INTERRUPTIBLE);
+		spin_unlock_irq(&pool->lock);
+		timeout = schedule_timeout(timeout);
+		spin_lock_irq(&pool->lock);
+	}
+	return 1;
+}
+
+static int pool_worker_thread(void *__worker)
+{
+	struct worker *worker = __worker;
+	struct worker_pool *pool = &worker_pool;
+	struct cpu_workqueue_struct *cwq;
+
+	current->flags |= PF_WQ_WORKER;
+
+	spin_lock_irq(&pool->lock);
+	while (pool_worker_wait(worker)) {
+		/*
+		 * Workers that blocked count as running again once they
+		 * wake up; if that makes too many, the extra ones go idle.
+		 */
+		while (!list_empty(&pool->pending) &&
+		       pool->nr_running <= num_online_cpus()) {
+			if (!pool->nr_idle && !pool->creating) {
+				pool->creating = 1;
+				spin_unlock_irq(&pool->lock);
+				create_pool_reserve();
+				spin_lock_irq(&pool->lock);
+				pool->creating = 0;
+				if (list_empty(&pool->pending))
+					break;
+			}
+
+			cwq = list_first_entry(&pool->pending,
+					struct cpu_workqueue_struct, pool_entry);
+			list_del_init(&cwq->pool_entry);
+			cwq->worker = worker;
+			worker->cwq = cwq;
+			spin_unlock_irq(&pool->lock);
+
+			run_workqueue(cwq);
+
+			spin_lock_irq(&pool->lock);
+			worker->cwq = NULL;
+		}
+
+		worker->flags |= WORKER_IDLE;
+		list_add(&worker->entry, &pool->idle);
+		pool->nr_idle++;
+		pool->nr_running--;
+	}
+	spin_unlock_irq(&pool->lock);
+
+	trace_workqueue_destruction(current);
+	current->flags &= ~PF_WQ_WORKER;
+	kfree(worker);
+	return 0;
+}
+
+/**
+ * wq_worker_sleeping - a pool worker is about to block
+ * @task: the worker, which must be current
+ *
+ * Called from schedule(). If no other worker is running while work is
+ * pending, wake up an idle one to take over.
+ */
+void wq_worker_sleeping(struct task_struct *task)
+{
+	struct worker *worker = kthread_data(task);
+	struct worker_pool *pool = &worker_pool;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (!(worker->flags & (WORKER_IDLE | WORKER_SLEEPING))) {
+		worker->flags |= WORKER_SLEEPING;
+		pool->nr_running--;
+		if (!pool->nr_running && !list_empty(&pool->pending) &&
+		    pool->nr_idle) {
+			wake_idle_worker(pool);
+			pool->handoffs++;
+		}
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+/**
+ * wq_worker_running - a pool worker returns from schedule()
+ * @task: the worker, which must be current
+ */
+void wq_worker_running(struct task_struct *task)
+{
+	struct worker *worker = kthread_data(task);
+	struct worker_pool *pool = &worker_pool;
+	unsigned long flags;
+
+	/* Only ever set by the worker itself */
+	if (!(worker->flags & WORKER_SLEEPING))
+		return;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	worker->flags &= ~WORKER_SLEEPING;
+	pool->nr_running++;
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+/* Is current the thread running @cwq's work items? */
+static int current_runs_cwq(struct cpu_workqueue_struct *cwq)
+{
+	if (current->flags & PF_WQ_WORKER) {
+		struct worker *worker = kthread_data(current);
+
+		return worker->cwq == cwq;
+	}
+	return cwq->thread == current;
+}
+
 struct wq_barrier {
 	struct work_struct	work;
 	struct completion	done;
@@ -363,7 +726,7 @@ static int flush_cpu_workqueue(struct cpu_workqueue_struct *cwq)
 	int active = 0;
 	struct wq_barrier barr;
 
-	WARN_ON(cwq->thread == current);
+	WARN_ON(current_runs_cwq(cwq));
 
 	spin_lock_irq(&cwq->lock);
 	if (!list_empty(&cwq->worklist) || cwq->current_work != NULL) {
@@ -781,6 +1144,7 @@ init_cpu_workqueue(struct workqueue_struct *wq, int cpu)
 	cwq->wq = wq;
 	spin_lock_init(&cwq->lock);
 	INIT_LIST_HEAD(&cwq->worklist);
+	INIT_LIST_HEAD(&cwq->pool_entry);
 	init_waitqueue_head(&cwq->more_work);
 
 	return cwq;
@@ -828,6 +1192,7 @@ struct workqueue_struct *__create_workqueue_key(const char *name,
 						int singlethread,
 						int freezeable,
 						int rt,
+						int reclaim,
 						struct lock_class_key *key,
 						const char *lock_name)
 {
@@ -850,9 +1215,17 @@ struct workqueue_struct *__create_workqueue_key(const char *name,
 	wq->singlethread = singlethread;
 	wq->freezeable = freezeable;
 	wq->rt = rt;
+	wq->pooled = singlethread && !freezeable && !rt && !reclaim;
 	INIT_LIST_HEAD(&wq->list);
+#ifdef CONFIG_WORKQUEUE_STATS
+	spin_lock(&workqueue_lock);
+	list_add_tail(&wq->stats_list, &stats_workqueues);
+	spin_unlock(&workqueue_lock);
+#endif
 
-	if (singlethread) {
+	if (wq->pooled) {
+		init_cpu_workqueue(wq, singlethread_cpu);
+	} else if (singlethread) {
 		cwq = init_cpu_workqueue(wq, singlethread_cpu);
 		err = create_workqueue_thread(cwq, singlethread_cpu);
 		start_workqueue_thread(cwq, -1);
@@ -891,8 +1264,36 @@ struct workqueue_struct *__create_workqueue_key(const char *name,
 }
 EXPORT_SYMBOL_GPL(__create_workqueue_key);
 
+/*
+ * A pooled cwq has no thread to stop. Once it is flushed, wait for the
+ * worker that ran the barrier to let go of it.
+ */
+static void cleanup_pooled_cwq(struct cpu_workqueue_struct *cwq)
+{
+	struct worker_pool *pool = &worker_pool;
+	int busy;
+
+	flush_cpu_workqueue(cwq);
+	for (;;) {
+		spin_lock_irq(&cwq->lock);
+		spin_lock(&pool->lock);
+		list_del_init(&cwq->pool_entry);
+		busy = cwq->worker != NULL;
+		spin_unlock(&pool->lock);
+		spin_unlock_irq(&cwq->lock);
+		if (!busy)
+			break;
+		schedule_timeout_uninterruptible(1);
+	}
+}
+
 static void cleanup_workqueue_thread(struct cpu_workqueue_struct *cwq)
 {
+	if (is_wq_pooled(cwq->wq)) {
+		cleanup_pooled_cwq(cwq);
+		return;
+	}
+
 	/*
 	 * Our caller is either destroy_workqueue() or CPU_POST_DEAD,
 	 * cpu_add_remove_lock protects cwq->thread.
@@ -933,6 +1334,9 @@ void destroy_workqueue(struct workqueue_struct *wq)
 	cpu_maps_update_begin();
 	spin_lock(&workqueue_lock);
 	list_del(&wq->list);
+#ifdef CONFIG_WORKQUEUE_STATS
+	list_del(&wq->stats_list);
+#endif
 	spin_unlock(&workqueue_lock);
 
 	for_each_cpu(cpu, cpu_map)
@@ -1072,4 +1476,103 @@ void __init init_workqueues(void)
 	hotcpu_notifier(workqueue_cpu_callback, 0);
 	keventd_wq = create_workqueue("events");
 	BUG_ON(!keventd_wq);
+	BUG_ON(create_pool_worker() || create_pool_worker());
+}
+
+#ifdef CONFIG_WORKQUEUE_STATS
+static int workqueue_stats_show(struct seq_file *m, void *unused)
+{
+	struct worker_pool *pool = &worker_pool;
+	struct cpu_workqueue_struct *cwq;
+	struct workqueue_struct *wq;
+	unsigned long executed;
+	u64 exec_ns, max_exec_ns, latency_ns, max_latency_ns;
+	int cpu, threads;
+
+	spin_lock_irq(&pool->lock);
+	seq_printf(m, "pool: %d workers, %d idle, %d running, %lu handoffs\n",
+		   pool->nr_workers, pool->nr_idle, pool->nr_running,
+		   pool->handoffs);
+	spin_unlock_irq(&pool->lock);
+
+	seq_printf(m, "%-24s %7s %9s %10s %10s %10s %10s\n", "name",
+		   "threads", "executed", "exec_us", "max_us", "avg_lat_us",
+		   "max_lat_us");
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &stats_workqueues, stats_list) {
+		executed = 0;
+		exec_ns = max_exec_ns = latency_ns = max_latency_ns = 0;
+		threads = 0;
+		for_each_cpu(cpu, wq_cpu_map(wq)) {
+			cwq = per_cpu_ptr(wq->cpu_wq, cpu);
+			spin_lock_irq(&cwq->lock);
+			if (cwq->thread)
+				threads++;
+			executed += cwq->executed;
+			exec_ns += cwq->exec_ns;
+			max_exec_ns = max(max_exec_ns, cwq->max_exec_ns);
+			latency_ns += cwq->latency_ns;
+			max_latency_ns = max(max_latency_ns,
+					     cwq->max_latency_ns);
+			spin_unlock_irq(&cwq->lock);
+		}
+		if (executed)
+			latency_ns = div_u64(latency_ns, executed);
+		seq_printf(m, "%-24s %7d %9lu %10llu %10llu %10llu %10llu\n",
+			   wq->name, threads, executed,
+			   div_u64(exec_ns, NSEC_PER_USEC),
+			   div_u64(max_exec_ns, NSEC_PER_USEC),
+			   div_u64(latency_ns, NSEC_PER_USEC),
+			   div_u64(max_latency_ns, NSEC_PER_USEC));
+	}
+	spin_unlock(&workqueue_lock);
+
+	return 0;
+}
+
+static int workqueue_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, workqueue_stats_show, NULL);
+}
+
+/* Any write resets the counters */
+static ssize_t workqueue_stats_write(struct file *file, const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct cpu_workqueue_struct *cwq;
+	struct workqueue_struct *wq;
+	int cpu;
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &stats_workqueues, stats_list) {
+		for_each_cpu(cpu, wq_cpu_map(wq)) {
+			cwq = per_cpu_ptr(wq->cpu_wq, cpu);
+			spin_lock_irq(&cwq->lock);
+			cwq->executed = 0;
+			cwq->exec_ns = cwq->max_exec_ns = 0;
+			cwq->latency_ns = cwq->max_latency_ns = 0;
+			spin_unlock_irq(&cwq->lock);
+		}
+	}
+	spin_unlock(&workqueue_lock);
+
+	return count;
+}
+
+static const struct file_operations workqueue_stats_fops = {
+	.open		= workqueue_stats_open,
+	.read		= seq_read,
+	.write		= workqueue_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init workqueue_stats_init(void)
+{
+	debugfs_create_file("workqueue_stats", 0644, NULL, NULL,
+			    &workqueue_stats_fops);
+	return 0;
 }
+late_initcall(workqueue_stats_init);
+#endif /* CONFIG_WORKQUEUE_STATS */
@@ -0,0 +1,9 @@
+/*
+ * kernel/workqueue_sched.h
+ *
+ * Scheduler hooks for the workqueue worker pool, included only by
+ * kernel/sched.c.
+ */
+
+void wq_worker_sleeping(struct task_struct *task);
+void wq_worker_running(struct task_struct *task);
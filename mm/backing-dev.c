@@ -215,12 +215,33 @@ static ssize_t max_ratio_store(struct device *dev,
 }
 BDI_SHOW(max_ratio, bdi->max_ratio)
 
+static ssize_t no_seek_penalty_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	char *end;
+	unsigned long val;
+	ssize_t ret = -EINVAL;
+
+	val = simple_strtoul(buf, &end, 10);
+	if (*buf && (end[0] == '\0' || (end[0] == '\n' && end[1] == '\0'))) {
+		if (val)
+			bdi->capabilities |= BDI_CAP_NO_SEEK_PENALTY;
+		else
+			bdi->capabilities &= ~BDI_CAP_NO_SEEK_PENALTY;
+		ret = count;
+	}
+	return ret;
+}
+BDI_SHOW(no_seek_penalty, bdi_cap_no_seek_penalty(bdi))
+
 #define __ATTR_RW(attr) __ATTR(attr, 0644, attr##_show, attr##_store)
 
 static struct device_attribute bdi_dev_attrs[] = {
 	__ATTR_RW(read_ahead_kb),
 	__ATTR_RW(min_ratio),
 	__ATTR_RW(max_ratio),
+	__ATTR_RW(no_seek_penalty),
 	__ATTR_NULL,
 };
 
@@ -0,0 +1,488 @@
+/*
+ * mm/boot_prefetch.c - record boot-time page cache misses and replay them
+ *
+ * This file is released under the GPLv2.
+ *
+ * Booting is dominated by small reads scattered over /system libraries,
+ * jars and APKs, each of which waits for its own I/O. With
+ * boot_prefetch.record=1 on the command line, every file page read in
+ * because it was not cached is recorded, for record_secs seconds or
+ * until the trace is read from /proc/boot_prefetch. The trace lists the
+ * files in the order they were first read, each with its pages sorted
+ * and merged into ranges:
+ *
+ *	# boot_prefetch 1
+ *	F /system/framework/framework.jar
+ *	0 32
+ *	40 8
+ *	F /system/lib/libdvm.so
+ *	...
+ *
+ * where each range line is "<first page> <number of pages>". Writing a
+ * trace back to /proc/boot_prefetch early in a later boot, before
+ * zygote starts, has a kernel thread push all of it through
+ * force_page_cache_readahead(), so that the I/O is issued in large
+ * sorted requests ahead of the processes that need it. Both sides log
+ * how long they took, for comparison with the boot time.
+ */
+
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/pagemap.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#define PREFETCH_HASH_BITS	8
+#define PREFETCH_MAX_PAGES	65536		/* 256MB of page cache */
+#define PREFETCH_MAX_TRACE	(1024 * 1024)	/* bytes */
+
+struct prefetch_file {
+	struct list_head	list;		/* in first-read order */
+	struct hlist_node	hash;
+	struct inode		*inode;		/* pinned while recording */
+	char			*path;
+	u32			*pages;		/* sorted once recording stops */
+	unsigned int		nr;		/* entries used in pages */
+	unsigned int		size;		/* entries allocated */
+};
+
+int boot_prefetch_recording;
+static unsigned int record_secs = 120;
+static unsigned long record_start;
+static int record_done;
+
+/*
+ * prefetch_lock protects the recorded files and replay_task. Recording
+ * is one-shot and files are only added while it runs, so once it has
+ * stopped the list is stable.
+ */
+static DEFINE_MUTEX(prefetch_lock);
+static LIST_HEAD(prefetch_files);
+static struct hlist_head prefetch_hash[1 << PREFETCH_HASH_BITS];
+static unsigned int prefetch_pages;
+static int prefetch_sorted;
+static struct task_struct *replay_task;
+
+static void prefetch_timeout(struct work_struct *work);
+static DECLARE_DELAYED_WORK(prefetch_timeout_work, prefetch_timeout);
+static int prefetch_ready;	/* past init, so the timeout can be queued */
+
+/* record_secs is applied when checking, so the parameter order is free */
+static int set_record(const char *val, struct kernel_param *kp)
+{
+	int ret;
+
+	if (record_done)
+		return -EBUSY;
+	ret = param_set_bool(val, kp);
+
+	if (!ret && boot_prefetch_recording) {
+		record_start = jiffies;
+		if (prefetch_ready)
+			schedule_delayed_work(&prefetch_timeout_work,
+					      record_secs * HZ + 1);
+	}
+	return ret;
+}
+module_param_call(record, set_record, param_get_bool,
+		  &boot_prefetch_recording, 0644);
+module_param(record_secs, uint, 0644);
+
+static struct prefetch_file *prefetch_lookup(struct inode *inode)
+{
+	struct prefetch_file *pf;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(pf, node,
+			&prefetch_hash[hash_ptr(inode, PREFETCH_HASH_BITS)], hash)
+		if (pf->inode == inode)
+			return pf;
+	return NULL;
+}
+
+static struct prefetch_file *prefetch_add(struct file *filp)
+{
+	struct prefetch_file *pf;
+	char *buf, *path;
+
+	pf = kzalloc(sizeof(*pf), GFP_KERNEL);
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	if (!pf || !buf)
+		goto fail;
+
+	path = d_path(&filp->f_path, buf, PAGE_SIZE);
+	if (IS_ERR(path))
+		goto fail;
+	pf->path = kstrdup(path, GFP_KERNEL);
+	if (!pf->path)
+		goto fail;
+	pf->inode = igrab(filp->f_mapping->host);
+	if (!pf->inode)
+		goto fail;
+	free_page((unsigned long)buf);
+
+	list_add_tail(&pf->list, &prefetch_files);
+	hlist_add_head(&pf->hash, &prefetch_hash[hash_ptr(pf->inode,
+							   PREFETCH_HASH_BITS)]);
+	return pf;
+fail:
+	free_page((unsigned long)buf);
+	if (pf)
+		kfree(pf->path);
+	kfree(pf);
+	return NULL;
+}
+
+static void prefetch_stop_locked(void)
+{
+	struct prefetch_file *pf;
+
+	if (!boot_prefetch_recording)
+		return;
+
+	pr_info("boot_prefetch: recorded %u pages in %u ms\n",
+		prefetch_pages, jiffies_to_msecs(jiffies - record_start));
+	boot_prefetch_recording = 0;
+	record_done = 1;
+	list_for_each_entry(pf, &prefetch_files, list)
+		hlist_del(&pf->hash);
+}
+
+/*
+ * Drop the inodes pinned while recording, once it has stopped. The final
+ * iput() may evict the inode, so this runs without prefetch_lock; xchg()
+ * keeps racing callers from dropping the same reference twice.
+ */
+static void prefetch_put_inodes(void)
+{
+	struct prefetch_file *pf;
+	struct inode *inode;
+
+	list_for_each_entry(pf, &prefetch_files, list) {
+		inode = xchg(&pf->inode, NULL);
+		if (inode)
+			iput(inode);
+	}
+}
+
+/**
+ * __boot_prefetch_record - note a page cache miss
+ * @filp: file being read
+ * @index: page that was not cached
+ *
+ * Called through boot_prefetch_record() only while recording.
+ */
+void __boot_prefetch_record(struct file *filp, pgoff_t index)
+{
+	struct address_space *mapping;
+	struct prefetch_file *pf;
+	int stopped = 0;
+
+	if (!filp)
+		return;
+	mapping = filp->f_mapping;
+	if (!S_ISREG(mapping->host->i_mode) || mapping_cap_swap_backed(mapping))
+		return;
+
+	mutex_lock(&prefetch_lock);
+	if (!boot_prefetch_recording || current == replay_task)
+		goto out;
+	if (time_after(jiffies, record_start + record_secs * HZ) ||
+	    prefetch_pages >= PREFETCH_MAX_PAGES) {
+		prefetch_stop_locked();
+		stopped = 1;
+		goto out;
+	}
+
+	pf = prefetch_lookup(mapping->host);
+	if (!pf)
+		pf = prefetch_add(filp);
+	if (!pf)
+		goto out;
+
+	/* readahead records its pages in order; skip the easy repeats */
+	if (pf->nr && pf->pages[pf->nr - 1] == index)
+		goto out;
+
+	if (pf->nr == pf->size) {
+		unsigned int size = pf->size ? 2 * pf->size : 16;
+		u32 *pages = krealloc(pf->pages, size * sizeof(u32),
+				      GFP_KERNEL);
+
+		if (!pages)
+			goto out;
+		pf->pages = pages;
+		pf->size = size;
+	}
+	pf->pages[pf->nr++] = index;
+	prefetch_pages++;
+out:
+	mutex_unlock(&prefetch_lock);
+	if (stopped)
+		prefetch_put_inodes();
+}
+
+/*
+ * Stop recording once record_secs have passed even if no further miss
+ * comes along to notice, so that the pinned inodes are not kept until
+ * the trace happens to be read.
+ */
+static void prefetch_timeout(struct work_struct *work)
+{
+	long left;
+
+	mutex_lock(&prefetch_lock);
+	left = (long)(record_start + record_secs * HZ - jiffies);
+	if (boot_prefetch_recording && left >= 0) {
+		/* not due yet: queued at init, or record_secs was raised */
+		schedule_delayed_work(&prefetch_timeout_work, left + 1);
+		mutex_unlock(&prefetch_lock);
+		return;
+	}
+	prefetch_stop_locked();
+	mutex_unlock(&prefetch_lock);
+	prefetch_put_inodes();
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sort each file's pages; they are merged into ranges as they are shown */
+static void prefetch_sort_locked(void)
+{
+	struct prefetch_file *pf;
+
+	if (prefetch_sorted)
+		return;
+
+	list_for_each_entry(pf, &prefetch_files, list)
+		sort(pf->pages, pf->nr, sizeof(u32), cmp_u32, NULL);
+	prefetch_sorted = 1;
+}
+
+static void *prefetch_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&prefetch_lock);
+	return seq_list_start_head(&prefetch_files, *pos);
+}
+
+static void *prefetch_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	return seq_list_next(v, &prefetch_files, pos);
+}
+
+static void prefetch_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&prefetch_lock);
+}
+
+static int prefetch_seq_show(struct seq_file *m, void *v)
+{
+	struct prefetch_file *pf;
+	unsigned int i;
+
+	if (v == &prefetch_files) {
+		seq_puts(m, "# boot_prefetch 1\n");
+		return 0;
+	}
+
+	pf = list_entry(v, struct prefetch_file, list);
+	if (!pf->nr)
+		return 0;
+	seq_printf(m, "F %s\n", pf->path);
+	for (i = 0; i < pf->nr; i++) {
+		u32 start = pf->pages[i], len = 1;
+
+		while (i + 1 < pf->nr && pf->pages[i + 1] <= start + len) {
+			if (pf->pages[i + 1] == start + len)
+				len++;
+			i++;
+		}
+		seq_printf(m, "%u %u\n", start, len);
+	}
+	return 0;
+}
+
+static const struct seq_operations prefetch_seq_ops = {
+	.start	= prefetch_seq_start,
+	.next	= prefetch_seq_next,
+	.stop	= prefetch_seq_stop,
+	.show	= prefetch_seq_show,
+};
+
+/* A trace being written, replayed once the writer closes the file */
+struct prefetch_trace {
+	char		*buf;
+	size_t		len;
+};
+
+static int prefetch_replay(void *data)
+{
+	struct prefetch_trace *trace = data;
+	struct file *filp = NULL;
+	char *line, *next = trace->buf;
+	unsigned long files = 0, pages = 0;
+	unsigned int start, len;
+	int ret;
+	ktime_t calltime = ktime_get();
+
+	while ((line = strsep(&next, "\n")) != NULL) {
+		if (line[0] == 'F' && line[1] == ' ') {
+			if (filp)
+				filp_close(filp, NULL);
+			filp = filp_open(line + 2, O_RDONLY | O_LARGEFILE, 0);
+			if (IS_ERR(filp))
+				filp = NULL;
+			else
+				files++;
+		} else if (filp && sscanf(line, "%u %u", &start, &len) == 2) {
+			ret = force_page_cache_readahead(filp->f_mapping, filp,
+							 start, len);
+			if (ret > 0)
+				pages += ret;
+		}
+	}
+	if (filp)
+		filp_close(filp, NULL);
+
+	pr_info("boot_prefetch: replayed %lu pages of %lu files in %lld ms\n",
+		pages, files,
+		ktime_to_ns(ktime_sub(ktime_get(), calltime)) / NSEC_PER_MSEC);
+
+	vfree(trace->buf);
+	kfree(trace);
+	mutex_lock(&prefetch_lock);
+	replay_task = NULL;
+	mutex_unlock(&prefetch_lock);
+	return 0;
+}
+
+static int prefetch_open(struct inode *inode, struct file *file)
+{
+	struct prefetch_trace *trace;
+
+	/* the trace read out and the one written in are unrelated */
+	if ((file->f_mode & FMODE_READ) && (file->f_mode & FMODE_WRITE))
+		return -EINVAL;
+
+	if (!(file->f_mode & FMODE_WRITE)) {
+		/* Reading the trace ends the recording */
+		mutex_lock(&prefetch_lock);
+		prefetch_stop_locked();
+		prefetch_sort_locked();
+		mutex_unlock(&prefetch_lock);
+		prefetch_put_inodes();
+		return seq_open(file, &prefetch_seq_ops);
+	}
+
+	trace = kzalloc(sizeof(*trace), GFP_KERNEL);
+	if (!trace)
+		return -ENOMEM;
+	trace->buf = vmalloc(PREFETCH_MAX_TRACE + 1);
+	if (!trace->buf) {
+		kfree(trace);
+		return -ENOMEM;
+	}
+	file->private_data = trace;
+	return 0;
+}
+
+/* A file opened for writing has no seq_file behind it */
+static ssize_t prefetch_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	if (file->f_mode & FMODE_WRITE)
+		return -EINVAL;
+	return seq_read(file, buf, count, ppos);
+}
+
+static loff_t prefetch_llseek(struct file *file, loff_t offset, int origin)
+{
+	if (file->f_mode & FMODE_WRITE)
+		return -ESPIPE;
+	return seq_lseek(file, offset, origin);
+}
+
+static ssize_t prefetch_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct prefetch_trace *trace = file->private_data;
+
+	if (count > PREFETCH_MAX_TRACE - trace->len)
+		return -EFBIG;
+	if (copy_from_user(trace->buf + trace->len, buf, count))
+		return -EFAULT;
+	trace->len += count;
+	return count;
+}
+
+static int prefetch_release(struct inode *inode, struct file *file)
+{
+	struct prefetch_trace *trace = file->private_data;
+	struct task_struct *task;
+
+	if (!(file->f_mode & FMODE_WRITE))
+		return seq_release(inode, file);
+
+	trace->buf[trace->len] = '\0';
+	if (!trace->len)
+		goto out_free;
+
+	mutex_lock(&prefetch_lock);
+	if (replay_task) {
+		mutex_unlock(&prefetch_lock);
+		goto out_free;
+	}
+	task = kthread_create(prefetch_replay, trace, "kprefetchd");
+	if (IS_ERR(task)) {
+		mutex_unlock(&prefetch_lock);
+		goto out_free;
+	}
+	replay_task = task;
+	mutex_unlock(&prefetch_lock);
+	wake_up_process(task);
+	return 0;
+
+out_free:
+	vfree(trace->buf);
+	kfree(trace);
+	return 0;
+}
+
+static const struct file_operations prefetch_fops = {
+	.open		= prefetch_open,
+	.read		= prefetch_read,
+	.write		= prefetch_write,
+	.llseek		= prefetch_llseek,
+	.release	= prefetch_release,
+};
+
+static int __init boot_prefetch_init(void)
+{
+	proc_create("boot_prefetch", S_IRUSR | S_IWUSR, NULL, &prefetch_fops);
+
+	/* boot_prefetch.record=1 was parsed before workqueues existed */
+	prefetch_ready = 1;
+	if (boot_prefetch_recording)
+		schedule_delayed_work(&prefetch_timeout_work, 0);
+	return 0;
+}
+module_init(boot_prefetch_init);
@@ -8,6 +8,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/capability.h>
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
@@ -17,9 +18,68 @@
 #include <linux/fadvise.h>
 #include <linux/writeback.h>
 #include <linux/syscalls.h>
+#include <linux/swap.h>
 
 #include <asm/unistd.h>
 
+/*
+ * With @hot, mark the cached pages of [start, end] as hot code and
+ * activate them, for as long as their zone has hot code budget left.
+ * Without it, take the protection away again. The mapping's nrhotcode
+ * follows PG_hotcode under tree_lock, so that clearing can stop early.
+ */
+static void mark_hotcode_pages(struct address_space *mapping,
+			       pgoff_t start, pgoff_t end, int hot)
+{
+	struct pagevec pvec;
+	pgoff_t next = start;
+	int i, done = 0;
+
+	lru_add_drain();
+	pagevec_init(&pvec, 0);
+	while (!done && next <= end && (hot || mapping->nrhotcode) &&
+	       pagevec_lookup(&pvec, mapping, next, PAGEVEC_SIZE)) {
+		for (i = 0; i < pagevec_count(&pvec); i++) {
+			struct page *page = pvec.pages[i];
+
+			if (page->index > end) {
+				done = 1;
+				break;
+			}
+			next = page->index + 1;
+			if (!next)
+				done = 1;
+
+			/* the common case for POSIX_FADV_NORMAL */
+			if (!hot && !PageHotcode(page))
+				continue;
+
+			lock_page(page);
+			if (page->mapping != mapping) {
+				/* truncated meanwhile */
+			} else if (!hot) {
+				spin_lock_irq(&mapping->tree_lock);
+				if (TestClearPageHotcode(page)) {
+					__dec_zone_page_state(page, NR_HOTCODE);
+					mapping->nrhotcode--;
+				}
+				spin_unlock_irq(&mapping->tree_lock);
+			} else if (!PageHotcode(page) &&
+				   hotcode_page_allowed(page)) {
+				spin_lock_irq(&mapping->tree_lock);
+				SetPageHotcode(page);
+				__inc_zone_page_state(page, NR_HOTCODE);
+				mapping->nrhotcode++;
+				spin_unlock_irq(&mapping->tree_lock);
+				activate_page(page);
+			}
+			unlock_page(page);
+		}
+		pagevec_release(&pvec);
+		cond_resched();
+	}
+}
+
 /*
  * POSIX_FADV_WILLNEED could set PG_Referenced, and POSIX_FADV_NOREUSE could
  * deactivate the pages and clear PG_Referenced.
@@ -57,6 +117,7 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 		case POSIX_FADV_WILLNEED:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
+		case POSIX_FADV_HOTCODE:
 			/* no bad return value, but ignore advice */
 			break;
 		default:
@@ -77,6 +138,9 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 	switch (advice) {
 	case POSIX_FADV_NORMAL:
 		file->f_ra.ra_pages = bdi->ra_pages;
+		if (mapping->nrhotcode && capable(CAP_IPC_LOCK))
+			mark_hotcode_pages(mapping, offset >> PAGE_CACHE_SHIFT,
+					   endbyte >> PAGE_CACHE_SHIFT, 0);
 		break;
 	case POSIX_FADV_RANDOM:
 		file->f_ra.ra_pages = 0;
@@ -105,12 +169,49 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 		if (ret > 0)
 			ret = 0;
 		break;
+	case POSIX_FADV_HOTCODE:
+		/*
+		 * Like POSIX_FADV_WILLNEED, then protect what was read in.
+		 * Pages that are reclaimed anyway lose the protection, and
+		 * POSIX_FADV_NORMAL or POSIX_FADV_DONTNEED drop it, when
+		 * issued with the same capability. Pinning page cache
+		 * against reclaim is akin to mlock().
+		 */
+		if (!capable(CAP_IPC_LOCK)) {
+			ret = -EPERM;
+			break;
+		}
+		if (!mapping->a_ops->readpage ||
+		    mapping_cap_swap_backed(mapping)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		start_index = offset >> PAGE_CACHE_SHIFT;
+		end_index = endbyte >> PAGE_CACHE_SHIFT;
+		nrpages = end_index - start_index + 1;
+		if (!nrpages)
+			nrpages = ~0UL;
+
+		ret = force_page_cache_readahead(mapping, file,
+				start_index,
+				nrpages);
+		if (ret < 0)
+			break;
+		mark_hotcode_pages(mapping, start_index, end_index, 1);
+		ret = 0;
+		break;
 	case POSIX_FADV_NOREUSE:
 		break;
 	case POSIX_FADV_DONTNEED:
 		if (!bdi_write_congested(mapping->backing_dev_info))
 			filemap_flush(mapping);
 
+		/* Hot code protection goes for partial pages too */
+		if (mapping->nrhotcode && capable(CAP_IPC_LOCK))
+			mark_hotcode_pages(mapping, offset >> PAGE_CACHE_SHIFT,
+					   endbyte >> PAGE_CACHE_SHIFT, 0);
+
 		/* First and last FULL page! */
 		start_index = (offset+(PAGE_CACHE_SIZE-1)) >> PAGE_CACHE_SHIFT;
 		end_index = (endbyte >> PAGE_CACHE_SHIFT);
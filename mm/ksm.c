@@ -32,6 +32,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/swap.h>
 #include <linux/ksm.h>
+#include <linux/math64.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -74,6 +75,13 @@
  *    take 10 attempts to find a page in the unstable tree, once it is found,
  *    it is secured in the stable tree.  (When we scan a new page, we first
  *    compare it against the stable tree, and then against the unstable tree.)
+ *
+ * Both trees are sorted by the checksum of a page's contents first, taken
+ * when the page was inserted, and only then by the contents themselves.
+ * Walking down the trees mostly compares two numbers, without looking up
+ * or reading the page of each node it passes; and since a node's checksum
+ * never changes, a modified page cannot misdirect a walk down the unstable
+ * tree any more than a stale node could.
  */
 
 /**
@@ -112,6 +120,7 @@ struct ksm_scan {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @checksum: checksum of the page's contents, its key in either tree
  * @node: rb_node of this rmap_item in either unstable or stable tree
  * @next: next rmap_item hanging off the same node of the stable tree
  * @prev: previous rmap_item hanging off the same node of the stable tree
@@ -124,6 +133,7 @@ struct rmap_item {
 		unsigned int oldchecksum;		/* when unstable */
 		struct rmap_item *next;			/* when stable */
 	};
+	unsigned int checksum;
 	union {
 		struct rb_node node;			/* when tree node */
 		struct rmap_item *prev;			/* in stable list */
@@ -160,6 +170,9 @@ static unsigned long ksm_pages_sharing;
 /* The number of nodes in the unstable tree */
 static unsigned long ksm_pages_unshared;
 
+/* The number of pages freed by merging, since boot */
+static unsigned long ksm_pages_merged;
+
 /* The number of rmap_items in use: to calculate pages_volatile */
 static unsigned long ksm_rmap_items;
 
@@ -172,6 +185,20 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Size batches by reclaim activity, up to pages_to_scan */
+static unsigned int ksm_pressure_scan = 1;
+
+/* Number of pages in the current batch, when sized by reclaim activity */
+static unsigned int ksm_scan_npages;
+
+/* Children of tasks with these names have all their private memory merged */
+#define KSM_MERGE_COMMS		4
+static char ksm_merge_comm[KSM_MERGE_COMMS][TASK_COMM_LEN];
+unsigned int ksm_nr_merge_comms;
+static DEFINE_SPINLOCK(ksm_merge_comm_lock);
+
+static struct task_struct *ksm_thread;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -882,6 +909,7 @@ out:
  * NULL otherwise.
  */
 static struct rmap_item *stable_tree_search(struct page *page,
+					    unsigned int checksum,
 					    struct page **page2,
 					    struct rmap_item *rmap_item)
 {
@@ -892,6 +920,14 @@ static struct rmap_item *stable_tree_search(struct page *page,
 		int ret;
 
 		tree_rmap_item = rb_entry(node, struct rmap_item, node);
+		if (checksum != tree_rmap_item->checksum) {
+			if (checksum < tree_rmap_item->checksum)
+				node = node->rb_left;
+			else
+				node = node->rb_right;
+			continue;
+		}
+
 		while (tree_rmap_item) {
 			BUG_ON(!in_stable_tree(tree_rmap_item));
 			cond_resched();
@@ -932,6 +968,7 @@ static struct rmap_item *stable_tree_search(struct page *page,
  * This function returns rmap_item if success, NULL otherwise.
  */
 static struct rmap_item *stable_tree_insert(struct page *page,
+					    unsigned int checksum,
 					    struct rmap_item *rmap_item)
 {
 	struct rb_node **new = &root_stable_tree.rb_node;
@@ -943,6 +980,15 @@ static struct rmap_item *stable_tree_insert(struct page *page,
 		int ret;
 
 		tree_rmap_item = rb_entry(*new, struct rmap_item, node);
+		if (checksum != tree_rmap_item->checksum) {
+			parent = *new;
+			if (checksum < tree_rmap_item->checksum)
+				new = &parent->rb_left;
+			else
+				new = &parent->rb_right;
+			continue;
+		}
+
 		while (tree_rmap_item) {
 			BUG_ON(!in_stable_tree(tree_rmap_item));
 			cond_resched();
@@ -976,6 +1022,7 @@ static struct rmap_item *stable_tree_insert(struct page *page,
 
 	rmap_item->address |= NODE_FLAG | STABLE_FLAG;
 	rmap_item->next = NULL;
+	rmap_item->checksum = checksum;
 	rb_link_node(&rmap_item->node, parent, new);
 	rb_insert_color(&rmap_item->node, &root_stable_tree);
 
@@ -1002,6 +1049,7 @@ static struct rmap_item *stable_tree_insert(struct page *page,
  * the same walking algorithm in an rbtree.
  */
 static struct rmap_item *unstable_tree_search_insert(struct page *page,
+						unsigned int checksum,
 						struct page **page2,
 						struct rmap_item *rmap_item)
 {
@@ -1014,6 +1062,15 @@ static struct rmap_item *unstable_tree_search_insert(struct page *page,
 
 		cond_resched();
 		tree_rmap_item = rb_entry(*new, struct rmap_item, node);
+		if (checksum != tree_rmap_item->checksum) {
+			parent = *new;
+			if (checksum < tree_rmap_item->checksum)
+				new = &parent->rb_left;
+			else
+				new = &parent->rb_right;
+			continue;
+		}
+
 		page2[0] = get_mergeable_page(tree_rmap_item);
 		if (!page2[0])
 			return NULL;
@@ -1043,6 +1100,7 @@ static struct rmap_item *unstable_tree_search_insert(struct page *page,
 
 	rmap_item->address |= NODE_FLAG;
 	rmap_item->address |= (ksm_scan.seqnr & SEQNR_MASK);
+	rmap_item->checksum = checksum;
 	rb_link_node(&rmap_item->node, parent, new);
 	rb_insert_color(&rmap_item->node, &root_unstable_tree);
 
@@ -1066,6 +1124,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 
 	tree_rmap_item->next = rmap_item;
 	rmap_item->address |= STABLE_FLAG;
+	rmap_item->checksum = tree_rmap_item->checksum;
 
 	ksm_pages_sharing++;
 }
@@ -1089,15 +1148,20 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	if (in_stable_tree(rmap_item))
 		remove_rmap_item_from_tree(rmap_item);
 
+	checksum = calc_checksum(page);
+
 	/* We first start with searching the page inside the stable tree */
-	tree_rmap_item = stable_tree_search(page, page2, rmap_item);
+	tree_rmap_item = stable_tree_search(page, checksum, page2, rmap_item);
 	if (tree_rmap_item) {
 		if (page == page2[0])			/* forked */
 			err = 0;
-		else
+		else {
 			err = try_to_merge_with_ksm_page(rmap_item->mm,
 							 rmap_item->address,
 							 page, page2[0]);
+			if (!err)
+				ksm_pages_merged++;
+		}
 		put_page(page2[0]);
 
 		if (!err) {
@@ -1125,13 +1189,13 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it to the unstable tree, and we don't want to
 	 * waste our time to search if there is something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
 	}
 
-	tree_rmap_item = unstable_tree_search_insert(page, page2, rmap_item);
+	tree_rmap_item = unstable_tree_search_insert(page, checksum, page2,
+						     rmap_item);
 	if (tree_rmap_item) {
 		err = try_to_merge_two_pages(rmap_item->mm,
 					     rmap_item->address, page,
@@ -1153,9 +1217,11 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			 * to a ksm page left outside the stable tree,
 			 * in which case we need to break_cow on both.
 			 */
-			if (stable_tree_insert(page2[0], tree_rmap_item))
+			if (stable_tree_insert(page2[0], checksum,
+					       tree_rmap_item)) {
 				stable_tree_append(rmap_item, tree_rmap_item);
-			else {
+				ksm_pages_merged++;
+			} else {
 				break_cow(tree_rmap_item->mm,
 						tree_rmap_item->address);
 				break_cow(rmap_item->mm, rmap_item->address);
@@ -1340,6 +1406,39 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * Merging is worth most when memory is short: scan a full pages_to_scan
+ * batch while kswapd or direct reclaim are scanning, and let the batch
+ * decay towards a sixteenth of that while they are idle.
+ */
+static unsigned int ksm_scan_batch(void)
+{
+	static unsigned long last_pgscan;
+	unsigned long events[NR_VM_EVENT_ITEMS];
+	unsigned long pgscan = 0;
+	unsigned int min_npages;
+	int i;
+
+	if (!ksm_pressure_scan)
+		return ksm_thread_pages_to_scan;
+
+	all_vm_events(events);
+	for (i = 0; i < MAX_NR_ZONES; i++)
+		pgscan += events[PGSCAN_KSWAPD_NORMAL - ZONE_NORMAL + i] +
+			  events[PGSCAN_DIRECT_NORMAL - ZONE_NORMAL + i];
+
+	min_npages = max(ksm_thread_pages_to_scan / 16, 1U);
+	if (pgscan != last_pgscan)
+		ksm_scan_npages = ksm_thread_pages_to_scan;
+	else
+		ksm_scan_npages -= ksm_scan_npages / 8;
+	ksm_scan_npages = clamp(ksm_scan_npages, min_npages,
+				ksm_thread_pages_to_scan);
+	last_pgscan = pgscan;
+
+	return ksm_scan_npages;
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_user_nice(current, 5);
@@ -1347,7 +1446,7 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_scan_batch());
 		mutex_unlock(&ksm_thread_mutex);
 
 		if (ksmd_should_run()) {
@@ -1372,10 +1471,7 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		/*
 		 * Be somewhat over-protective for now!
 		 */
-		if (*vm_flags & (VM_MERGEABLE | VM_SHARED  | VM_MAYSHARE   |
-				 VM_PFNMAP    | VM_IO      | VM_DONTEXPAND |
-				 VM_RESERVED  | VM_HUGETLB | VM_INSERTPAGE |
-				 VM_MIXEDMAP  | VM_SAO))
+		if (*vm_flags & (VM_MERGEABLE | VM_KSM_EXCLUDED))
 			return 0;		/* just ignore the advice */
 
 		if (!test_bit(MMF_VM_MERGEABLE, &mm->flags)) {
@@ -1435,6 +1531,37 @@ int __ksm_enter(struct mm_struct *mm)
 	return 0;
 }
 
+static int ksm_merge_comm_match(const char *comm)
+{
+	int i, match = 0;
+
+	spin_lock(&ksm_merge_comm_lock);
+	for (i = 0; i < ksm_nr_merge_comms; i++) {
+		if (!strncmp(comm, ksm_merge_comm[i], TASK_COMM_LEN)) {
+			match = 1;
+			break;
+		}
+	}
+	spin_unlock(&ksm_merge_comm_lock);
+	return match;
+}
+
+/*
+ * Called from dup_mmap() before the parent's areas are copied, so that
+ * ksm_vma_flags() can mark them mergeable in a child of a merge_comm task.
+ */
+int __ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
+{
+	if (test_bit(MMF_VM_MERGE_ANY, &oldmm->flags) ||
+	    ksm_merge_comm_match(current->comm))
+		set_bit(MMF_VM_MERGE_ANY, &mm->flags);
+
+	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags) ||
+	    test_bit(MMF_VM_MERGE_ANY, &mm->flags))
+		return __ksm_enter(mm);
+	return 0;
+}
+
 void __ksm_exit(struct mm_struct *mm)
 {
 	struct mm_slot *mm_slot;
@@ -1466,6 +1593,7 @@ void __ksm_exit(struct mm_struct *mm)
 	if (easy_to_free) {
 		free_mm_slot(mm_slot);
 		clear_bit(MMF_VM_MERGEABLE, &mm->flags);
+		clear_bit(MMF_VM_MERGE_ANY, &mm->flags);
 		mmdrop(mm);
 	} else if (mm_slot) {
 		down_write(&mm->mmap_sem);
@@ -1530,6 +1658,77 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t pressure_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_pressure_scan);
+}
+
+static ssize_t pressure_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long flag;
+
+	err = strict_strtoul(buf, 10, &flag);
+	if (err || flag > 1)
+		return -EINVAL;
+
+	ksm_pressure_scan = flag;
+
+	return count;
+}
+KSM_ATTR(pressure_scan);
+
+static ssize_t merge_comm_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	spin_lock(&ksm_merge_comm_lock);
+	for (i = 0; i < ksm_nr_merge_comms; i++)
+		len += sprintf(buf + len, "%s%s", i ? " " : "",
+			       ksm_merge_comm[i]);
+	spin_unlock(&ksm_merge_comm_lock);
+	len += sprintf(buf + len, "\n");
+	return len;
+}
+
+/*
+ * Takes up to KSM_MERGE_COMMS task names separated by spaces; an empty
+ * write stops merging the private memory of newly forked children.
+ */
+static ssize_t merge_comm_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	char comm[KSM_MERGE_COMMS][TASK_COMM_LEN];
+	unsigned int nr = 0;
+	const char *p = buf;
+	size_t len;
+
+	for (;;) {
+		p += strspn(p, " \t\n");
+		if (!*p)
+			break;
+		len = strcspn(p, " \t\n");
+		if (nr == KSM_MERGE_COMMS || len >= TASK_COMM_LEN)
+			return -EINVAL;
+		strlcpy(comm[nr++], p, len + 1);
+		p += len;
+	}
+
+	spin_lock(&ksm_merge_comm_lock);
+	memcpy(ksm_merge_comm, comm, nr * TASK_COMM_LEN);
+	ksm_nr_merge_comms = nr;
+	spin_unlock(&ksm_merge_comm_lock);
+
+	return count;
+}
+KSM_ATTR(merge_comm);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1645,9 +1844,46 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static u64 ksm_thread_usecs(void)
+{
+	return div_u64(ksm_thread->se.sum_exec_runtime, NSEC_PER_USEC);
+}
+
+static ssize_t cpu_msecs_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ksm_thread_usecs(),
+						   USEC_PER_MSEC));
+}
+KSM_ATTR_RO(cpu_msecs);
+
+/* ksmd's CPU time so far for each MB it has freed by merging */
+static ssize_t cpu_usecs_per_mb_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	unsigned long merged = ksm_pages_merged;
+	u64 usecs = 0;
+
+	if (merged)
+		usecs = div64_u64(ksm_thread_usecs() << (20 - PAGE_SHIFT),
+				  merged);
+	return sprintf(buf, "%llu\n", (unsigned long long)usecs);
+}
+KSM_ATTR_RO(cpu_usecs_per_mb);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&pressure_scan_attr.attr,
+	&merge_comm_attr.attr,
 	&run_attr.attr,
 	&max_kernel_pages_attr.attr,
 	&pages_shared_attr.attr,
@@ -1655,6 +1891,9 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&cpu_msecs_attr.attr,
+	&cpu_usecs_per_mb_attr.attr,
 	NULL,
 };
 
@@ -1666,7 +1905,6 @@ static struct attribute_group ksm_attr_group = {
 
 static int __init ksm_init(void)
 {
-	struct task_struct *ksm_thread;
 	int err;
 
 	ksm_max_kernel_pages = totalram_pages / 4;
@@ -1683,6 +1921,7 @@ static int __init ksm_init(void)
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
 		err = PTR_ERR(ksm_thread);
+		ksm_thread = NULL;
 		goto out_free2;
 	}
 
@@ -71,6 +71,8 @@ enum mem_cgroup_stat_index {
 	MEM_CGROUP_STAT_PGPGOUT_COUNT,	/* # of pages paged out */
 	MEM_CGROUP_STAT_EVENTS,	/* sum of pagein + pageout for internal use */
 	MEM_CGROUP_STAT_SWAPOUT, /* # of pages, swapped out */
+	MEM_CGROUP_STAT_SOFT_RECLAIMED,	/* # reclaimed over soft limit */
+	MEM_CGROUP_STAT_LIMIT_RECLAIMED, /* # reclaimed at the hard limit */
 
 	MEM_CGROUP_STAT_NSTATS,
 };
@@ -488,6 +490,27 @@ static void mem_cgroup_swap_statistics(struct mem_cgroup *mem,
 	put_cpu();
 }
 
+/*
+ * Pages taken from a group by soft limit reclaim tell how hard global
+ * pressure is leaning on it; pages taken at its own limit tell how tight
+ * the limit is. Together they are what a low memory killer would want
+ * to know about a group before picking a victim from it.
+ */
+static void mem_cgroup_reclaim_statistics(struct mem_cgroup *mem,
+					  bool soft, int nr_reclaimed)
+{
+	struct mem_cgroup_stat *stat = &mem->stat;
+	struct mem_cgroup_stat_cpu *cpustat;
+	int cpu = get_cpu();
+
+	cpustat = &stat->cpustat[cpu];
+	__mem_cgroup_stat_add_safe(cpustat, soft ?
+				   MEM_CGROUP_STAT_SOFT_RECLAIMED :
+				   MEM_CGROUP_STAT_LIMIT_RECLAIMED,
+				   nr_reclaimed);
+	put_cpu();
+}
+
 static void mem_cgroup_charge_statistics(struct mem_cgroup *mem,
 					 struct page_cgroup *pc,
 					 bool charge)
@@ -1179,6 +1202,7 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 		else
 			ret = try_to_free_mem_cgroup_pages(victim, gfp_mask,
 						noswap, get_swappiness(victim));
+		mem_cgroup_reclaim_statistics(victim, check_soft, ret);
 		css_put(&victim->css);
 		/*
 		 * At shrinking usage, we can't check we should stop here or
@@ -2673,6 +2697,8 @@ enum {
 	MCS_INACTIVE_FILE,
 	MCS_ACTIVE_FILE,
 	MCS_UNEVICTABLE,
+	MCS_SOFT_RECLAIMED,
+	MCS_LIMIT_RECLAIMED,
 	NR_MCS_STAT,
 };
 
@@ -2694,7 +2720,9 @@ struct {
 	{"active_anon", "total_active_anon"},
 	{"inactive_file", "total_inactive_file"},
 	{"active_file", "total_active_file"},
-	{"unevictable", "total_unevictable"}
+	{"unevictable", "total_unevictable"},
+	{"soft_reclaimed", "total_soft_reclaimed"},
+	{"limit_reclaimed", "total_limit_reclaimed"}
 };
 
 
@@ -2718,6 +2746,10 @@ static int mem_cgroup_get_local_stat(struct mem_cgroup *mem, void *data)
 		val = mem_cgroup_read_stat(&mem->stat, MEM_CGROUP_STAT_SWAPOUT);
 		s->stat[MCS_SWAP] += val * PAGE_SIZE;
 	}
+	val = mem_cgroup_read_stat(&mem->stat, MEM_CGROUP_STAT_SOFT_RECLAIMED);
+	s->stat[MCS_SOFT_RECLAIMED] += val;
+	val = mem_cgroup_read_stat(&mem->stat, MEM_CGROUP_STAT_LIMIT_RECLAIMED);
+	s->stat[MCS_LIMIT_RECLAIMED] += val;
 
 	/* per zone stat */
 	val = mem_cgroup_get_local_zonestat(mem, LRU_INACTIVE_ANON);
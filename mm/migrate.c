@@ -347,6 +347,11 @@ static void migrate_page_copy(struct page *newpage, struct page *page)
 		SetPageChecked(newpage);
 	if (PageMappedToDisk(page))
 		SetPageMappedToDisk(newpage);
+	if (TestClearPageHotcode(page)) {
+		dec_zone_page_state(page, NR_HOTCODE);
+		SetPageHotcode(newpage);
+		inc_zone_page_state(newpage, NR_HOTCODE);
+	}
 
 	if (PageDirty(page)) {
 		clear_page_dirty_for_io(page);
@@ -580,6 +580,37 @@ static void free_one_page(struct zone *zone, struct page *page, int order,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * zone_batchsize() sizes the per-cpu lists for the zone, but how many
+ * pages are worth moving per hold of zone->lock depends on how fast this
+ * CPU is allocating and freeing. A refill or trim that comes within
+ * PCP_ADAPT_INTERVAL of the previous one doubles the batch, up to
+ * PCP_BATCH_SCALE times its base size; one after a quiet spell halves it
+ * again. The batch keeps the 2^n - 1 form zone_batchsize() gives it, and
+ * the high mark stays at six batches as in setup_pageset().
+ *
+ * Called with interrupts disabled.
+ */
+#define PCP_ADAPT_INTERVAL	(HZ / 50 ? HZ / 50 : 1)
+#define PCP_BATCH_SCALE		4
+
+static void pcp_adapt_batch(struct per_cpu_pages *pcp)
+{
+	unsigned long now = jiffies;
+
+	if (pcp->batch_min == pcp->batch_max)
+		return;
+
+	if (time_before(now, pcp->last_bulk + PCP_ADAPT_INTERVAL)) {
+		if (pcp->batch < pcp->batch_max)
+			pcp->batch = min(2 * pcp->batch + 1, pcp->batch_max);
+	} else if (pcp->batch > pcp->batch_min) {
+		pcp->batch = max((pcp->batch - 1) / 2, pcp->batch_min);
+	}
+	pcp->high = 6 * pcp->batch;
+	pcp->last_bulk = now;
+}
+
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
@@ -1076,22 +1107,17 @@ void mark_free_pages(struct zone *zone)
 #endif /* CONFIG_PM */
 
 /*
- * Free a 0-order page
+ * Checks and debug hooks for a 0-order page on its way to the per-cpu
+ * lists. Returns 0 if the page must not be freed.
  */
-static void free_hot_cold_page(struct page *page, int cold)
+static int free_pcp_prepare(struct page *page)
 {
-	struct zone *zone = page_zone(page);
-	struct per_cpu_pages *pcp;
-	unsigned long flags;
-	int migratetype;
-	int wasMlocked = __TestClearPageMlocked(page);
-
 	kmemcheck_free_shadow(page, 0);
 
 	if (PageAnon(page))
 		page->mapping = NULL;
 	if (free_pages_check(page))
-		return;
+		return 0;
 
 	if (!PageHighMem(page)) {
 		debug_check_no_locks_freed(page_address(page), PAGE_SIZE);
@@ -1100,13 +1126,18 @@ static void free_hot_cold_page(struct page *page, int cold)
 	arch_free_page(page, 0);
 	kernel_map_pages(page, 1, 0);
 
-	pcp = &zone_pcp(zone, get_cpu())->pcp;
-	migratetype = get_pageblock_migratetype(page);
-	set_page_private(page, migratetype);
-	local_irq_save(flags);
-	if (unlikely(wasMlocked))
-		free_page_mlock(page);
-	__count_vm_event(PGFREE);
+	set_page_private(page, get_pageblock_migratetype(page));
+	return 1;
+}
+
+/*
+ * Put a prepared page on the per-cpu list of its migratetype.
+ * Called with interrupts disabled.
+ */
+static void free_pcp_page(struct zone *zone, struct per_cpu_pages *pcp,
+			  struct page *page, int cold)
+{
+	int migratetype = page_private(page);
 
 	/*
 	 * We only track unmovable, reclaimable and movable on pcp lists.
@@ -1118,7 +1149,7 @@ static void free_hot_cold_page(struct page *page, int cold)
 	if (migratetype >= MIGRATE_PCPTYPES) {
 		if (unlikely(migratetype == MIGRATE_ISOLATE)) {
 			free_one_page(zone, page, 0, migratetype);
-			goto out;
+			return;
 		}
 		migratetype = MIGRATE_MOVABLE;
 	}
@@ -1128,12 +1159,51 @@ static void free_hot_cold_page(struct page *page, int cold)
 	else
 		list_add(&page->lru, &pcp->lists[migratetype]);
 	pcp->count++;
-	if (pcp->count >= pcp->high) {
-		free_pcppages_bulk(zone, pcp->batch, pcp);
-		pcp->count -= pcp->batch;
-	}
+}
+
+/*
+ * Once a per-cpu list reaches its high mark, give it back to the buddy
+ * allocator down to a batch below the mark, in one hold of zone->lock.
+ * Called with interrupts disabled.
+ */
+static void pcp_trim(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	int count;
+
+	if (pcp->count < pcp->high)
+		return;
+
+	/* a batch that just grew may have raised the mark past count */
+	pcp_adapt_batch(pcp);
+	count = min(pcp->count - pcp->high + pcp->batch, pcp->count);
+	if (count <= 0)
+		return;
+	free_pcppages_bulk(zone, count, pcp);
+	pcp->count -= count;
+}
+
+/*
+ * Free a 0-order page
+ */
+static void free_hot_cold_page(struct page *page, int cold)
+{
+	struct zone *zone = page_zone(page);
+	struct per_cpu_pages *pcp;
+	unsigned long flags;
+	int wasMlocked = __TestClearPageMlocked(page);
+
+	if (!free_pcp_prepare(page))
+		return;
+
+	pcp = &zone_pcp(zone, get_cpu())->pcp;
+	local_irq_save(flags);
+	if (unlikely(wasMlocked))
+		free_page_mlock(page);
+	__count_vm_event(PGFREE);
+
+	free_pcp_page(zone, pcp, page, cold);
+	pcp_trim(zone, pcp);
 
-out:
 	local_irq_restore(flags);
 	put_cpu();
 }
@@ -1197,6 +1267,7 @@ again:
 		list = &pcp->lists[migratetype];
 		local_irq_save(flags);
 		if (list_empty(list)) {
+			pcp_adapt_batch(pcp);
 			pcp->count += rmqueue_bulk(zone, 0,
 					pcp->batch, list,
 					migratetype, cold);
@@ -1968,6 +2039,123 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/* Pages taken per interrupts-off section in alloc_pages_bulk() */
+#define ALLOC_BULK_CHUNK	64
+
+/*
+ * Take up to @nr_pages order-0 pages from @zone, first from this CPU's
+ * list and then straight from the buddy lists under one hold of
+ * zone->lock. Returns the number of pages stored in @pages.
+ */
+static unsigned int alloc_pages_bulk_zone(struct zone *zone, gfp_t gfp_mask,
+			int migratetype, unsigned int nr_pages,
+			struct page **pages)
+{
+	int cold = !!(gfp_mask & __GFP_COLD);
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	struct page *page;
+	unsigned long flags;
+	unsigned int nr = 0, i, good;
+
+	if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) + nr_pages,
+			       zone_idx(zone), ALLOC_WMARK_LOW|ALLOC_CPUSET))
+		return 0;
+
+	pcp = &zone_pcp(zone, get_cpu())->pcp;
+	list = &pcp->lists[migratetype];
+	local_irq_save(flags);
+	while (nr < nr_pages && !list_empty(list)) {
+		if (cold)
+			page = list_entry(list->prev, struct page, lru);
+		else
+			page = list_entry(list->next, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+		pages[nr++] = page;
+	}
+	if (nr < nr_pages) {
+		LIST_HEAD(head);
+
+		rmqueue_bulk(zone, 0, nr_pages - nr, &head, migratetype, cold);
+		list_for_each_entry(page, &head, lru)
+			pages[nr++] = page;
+	}
+	__count_zone_vm_events(PGALLOC, zone, nr);
+	for (i = 0; i < nr; i++)
+		zone_statistics(zone, zone);
+	local_irq_restore(flags);
+	put_cpu();
+
+	/* as in buffered_rmqueue(), a page that fails the checks is dropped */
+	for (i = good = 0; i < nr; i++) {
+		VM_BUG_ON(bad_range(zone, pages[i]));
+		if (prep_new_page(pages[i], 0, gfp_mask))
+			continue;
+		trace_mm_page_alloc(pages[i], 0, gfp_mask, migratetype);
+		pages[good++] = pages[i];
+	}
+	return good;
+}
+
+/**
+ * alloc_pages_bulk - allocate a number of order-0 pages
+ * @gfp_mask: GFP flags for the allocation
+ * @nr_pages: number of pages wanted
+ * @pages: array to store them in
+ *
+ * Pages come from the preferred zone for @gfp_mask for as long as it
+ * stays above its low watermark, a chunk at a time with one hold of
+ * zone->lock per chunk instead of one per pcp batch. The rest, if any,
+ * is allocated a page at a time through the normal path, which may
+ * reclaim. Returns the number of pages stored in @pages; fewer than
+ * @nr_pages only if the allocation failed. Free them with
+ * free_pages_bulk() or __free_page().
+ */
+unsigned int alloc_pages_bulk(gfp_t gfp_mask, unsigned int nr_pages,
+			      struct page **pages)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int migratetype = allocflags_to_migratetype(gfp_mask);
+	struct zonelist *zonelist;
+	struct zone *zone;
+	struct page *page;
+	unsigned int nr = 0, got;
+
+	gfp_mask &= gfp_allowed_mask;
+
+	lockdep_trace_alloc(gfp_mask);
+
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	if (should_fail_alloc_page(gfp_mask, 0))
+		return 0;
+
+	zonelist = node_zonelist(numa_node_id(), gfp_mask);
+	first_zones_zonelist(zonelist, high_zoneidx, NULL, &zone);
+	if (zone && cpuset_zone_allowed_softwall(zone,
+						 gfp_mask | __GFP_HARDWALL)) {
+		while (nr < nr_pages) {
+			got = alloc_pages_bulk_zone(zone, gfp_mask, migratetype,
+					min_t(unsigned int, nr_pages - nr,
+					      ALLOC_BULK_CHUNK),
+					pages + nr);
+			if (!got)
+				break;
+			nr += got;
+		}
+	}
+
+	while (nr < nr_pages) {
+		page = alloc_page(gfp_mask);
+		if (!page)
+			break;
+		pages[nr++] = page;
+	}
+	return nr;
+}
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -2017,6 +2205,63 @@ void __free_pages(struct page *page, unsigned int order)
 
 EXPORT_SYMBOL(__free_pages);
 
+/**
+ * free_pages_bulk - release an array of order-0 pages
+ * @nr_pages: number of pages
+ * @pages: the pages
+ *
+ * Drops a reference on each page, as __free_page() would. The freed
+ * pages go on the per-cpu lists, which are only trimmed back to their
+ * high marks when they reach twice that or the array is done, so the
+ * pages go back to the buddy allocator in a few long holds of
+ * zone->lock rather than one per batch.
+ */
+void free_pages_bulk(unsigned int nr_pages, struct page **pages)
+{
+	struct zone *zone = NULL;
+	struct per_cpu_pages *pcp = NULL;
+	unsigned long flags;
+	unsigned int i;
+	int cpu = get_cpu();
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page = pages[i];
+		int wasMlocked;
+
+		if (!put_page_testzero(page))
+			continue;
+		trace_mm_page_free_direct(page, 0);
+
+		wasMlocked = __TestClearPageMlocked(page);
+		if (!free_pcp_prepare(page))
+			continue;
+
+		local_irq_save(flags);
+		if (unlikely(wasMlocked))
+			free_page_mlock(page);
+		__count_vm_event(PGFREE);
+
+		if (page_zone(page) != zone) {
+			if (zone)
+				pcp_trim(zone, pcp);
+			zone = page_zone(page);
+			pcp = &zone_pcp(zone, cpu)->pcp;
+		}
+		free_pcp_page(zone, pcp, page, 0);
+		if (pcp->count >= 2 * pcp->high)
+			pcp_trim(zone, pcp);
+		local_irq_restore(flags);
+	}
+
+	if (zone) {
+		local_irq_save(flags);
+		pcp_trim(zone, pcp);
+		local_irq_restore(flags);
+	}
+	put_cpu();
+}
+EXPORT_SYMBOL(free_pages_bulk);
+
 void free_pages(unsigned long addr, unsigned int order)
 {
 	if (addr != 0) {
@@ -3083,6 +3328,10 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->count = 0;
 	pcp->high = 6 * batch;
 	pcp->batch = max(1UL, 1 * batch);
+	pcp->batch_min = pcp->batch;
+	/* a zero high mark (boot pagesets, NOMMU) must stay zero */
+	pcp->batch_max = batch ? (pcp->batch + 1) * PCP_BATCH_SCALE - 1
+			       : pcp->batch;
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
 }
@@ -3102,6 +3351,8 @@ static void setup_pagelist_highmark(struct per_cpu_pageset *p,
 	pcp->batch = max(1UL, high/4);
 	if ((high/4) > (PAGE_SHIFT * 8))
 		pcp->batch = PAGE_SHIFT * 8;
+	/* an explicit high mark turns off adaptation */
+	pcp->batch_min = pcp->batch_max = pcp->batch;
 }
 
 
@@ -1,6 +1,7 @@
 #include <linux/mm.h>
 #include <linux/mmzone.h>
 #include <linux/bootmem.h>
+#include <linux/pfn.h>
 #include <linux/bit_spinlock.h>
 #include <linux/page_cgroup.h>
 #include <linux/hash.h>
@@ -42,6 +43,37 @@ struct page_cgroup *lookup_page_cgroup(struct page *page)
 	return base + offset;
 }
 
+/*
+ * The table covers every pfn the node spans, holes included. On boards
+ * whose memory banks are far apart, as on most MSM parts, much of it
+ * would describe pages that do not exist, so the table pages that only
+ * cover invalid pfns go back to bootmem, much as ARM frees the unused
+ * parts of mem_map.
+ * lookup_page_cgroup() is only ever called for pages that exist.
+ */
+static unsigned long __init free_node_page_cgroup_holes(struct page_cgroup *base,
+			unsigned long start_pfn, unsigned long nr_pages)
+{
+	unsigned long tpfn, tend, first, last, index, freed = 0;
+
+	tpfn = PFN_UP(__pa(base));
+	tend = PFN_DOWN(__pa(base + nr_pages));
+	for (; tpfn < tend; tpfn++) {
+		first = ((unsigned long)__va(PFN_PHYS(tpfn)) -
+			 (unsigned long)base) / sizeof(*base);
+		last = ((unsigned long)__va(PFN_PHYS(tpfn + 1)) - 1 -
+			(unsigned long)base) / sizeof(*base);
+		for (index = first; index <= last; index++)
+			if (pfn_valid(start_pfn + index))
+				break;
+		if (index <= last)
+			continue;
+		free_bootmem(PFN_PHYS(tpfn), PAGE_SIZE);
+		freed += PAGE_SIZE;
+	}
+	return freed;
+}
+
 static int __init alloc_node_page_cgroup(int nid)
 {
 	struct page_cgroup *base, *pc;
@@ -61,11 +93,14 @@ static int __init alloc_node_page_cgroup(int nid)
 	if (!base)
 		return -ENOMEM;
 	for (index = 0; index < nr_pages; index++) {
+		if (!pfn_valid(start_pfn + index))
+			continue;
 		pc = base + index;
 		__init_page_cgroup(pc, start_pfn + index);
 	}
 	NODE_DATA(nid)->node_page_cgroup = base;
 	total_usage += table_size;
+	total_usage -= free_node_page_cgroup_holes(base, start_pfn, nr_pages);
 	return 0;
 }
 
@@ -170,7 +170,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		rcu_read_lock();
 		page = radix_tree_lookup(&mapping->page_tree, page_offset);
 		rcu_read_unlock();
-		if (page)
+		if (page && !radix_tree_exceptional_entry(page))
 			continue;
 
 		page = page_cache_alloc_cold(mapping);
@@ -178,6 +178,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			break;
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
+		boot_prefetch_record(filp, page_offset);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
 		ret++;
@@ -248,10 +249,96 @@ unsigned long ra_submit(struct file_ra_state *ra,
 
 	actual = __do_page_cache_readahead(mapping, filp,
 					ra->start, ra->size, ra->async_size);
+	count_vm_events(PGRA_SUBMIT, actual);
 
 	return actual;
 }
 
+/*
+ * Readahead hit accounting.
+ *
+ * When a readahead window is replaced, the pages of it that the reader
+ * got to count as hits and the rest as misses. A reader that moves on
+ * to the next window in sequence used all of it; otherwise how far it
+ * got is told by prev_pos. mmap read-around windows (async_size == 0)
+ * are left alone, as faults do not track prev_pos; mmap_miss looks after
+ * those. The counts are per file and decay, so that they follow the
+ * current access pattern.
+ */
+#define RA_HISTORY_MAX	1024	/* pages */
+
+static void ra_account(struct file_ra_state *ra, unsigned long used)
+{
+	unsigned long size = ra->size;
+
+	if (!size || !ra->async_size)
+		return;
+
+	used = min(used, size);
+	ra->hits += used;
+	ra->misses += size - used;
+	count_vm_events(PGRA_HIT, used);
+	count_vm_events(PGRA_MISS, size - used);
+
+	if (ra->hits + ra->misses > RA_HISTORY_MAX) {
+		ra->hits /= 2;
+		ra->misses /= 2;
+	}
+}
+
+/*
+ * Settle the current window before it is replaced by one the reader did
+ * not reach in sequence.
+ */
+static void ra_settle(struct file_ra_state *ra)
+{
+	pgoff_t last;
+	unsigned long used = 0;
+
+	if (ra->prev_pos >= 0) {
+		last = ra->prev_pos >> PAGE_CACHE_SHIFT;
+		if (last >= ra->start)
+			used = last - ra->start + 1;
+	}
+	ra_account(ra, used);
+}
+
+/*
+ * Scale the maximum window by how well readahead has done on this file.
+ * Once a file has a window's worth of history, a reader that uses
+ * almost everything read for it may have windows twice the usual
+ * maximum, which is what streaming media wants. One that leaves most of
+ * it unread gets smaller windows. On devices where random reads cost no
+ * more than sequential ones the window shrinks much further, since
+ * reading less is all gain there; on others it is only halved, as an
+ * extra seek costs more than the wasted pages.
+ */
+static unsigned long ra_adapt_max(struct address_space *mapping,
+				  struct file_ra_state *ra, unsigned long max)
+{
+	unsigned long total = ra->hits + ra->misses;
+	int shift = 0;
+
+	if (total < ra->ra_pages)
+		return max;
+
+	if (ra->hits * 8 >= total * 7)
+		return max_sane_readahead(2 * ra->ra_pages);
+
+	if (bdi_cap_no_seek_penalty(mapping->backing_dev_info)) {
+		if (ra->hits * 2 < total)
+			shift++;
+		if (ra->hits * 4 < total)
+			shift++;
+		if (ra->hits * 8 < total)
+			shift++;
+	} else if (ra->hits * 4 < total) {
+		shift++;
+	}
+
+	return max >> shift ? max >> shift : 1;
+}
+
 /*
  * Set the initial window size, round to next power of 2 and square
  * for small size, x 4 for medium, and x 2 for large
@@ -342,7 +429,7 @@ static pgoff_t count_history_pages(struct address_space *mapping,
 	pgoff_t head;
 
 	rcu_read_lock();
-	head = radix_tree_prev_hole(&mapping->page_tree, offset - 1, max);
+	head = page_cache_prev_hole(mapping, offset - 1, max);
 	rcu_read_unlock();
 
 	return offset - 1 - head;
@@ -375,6 +462,7 @@ static int try_context_readahead(struct address_space *mapping,
 	if (size >= offset)
 		size *= 2;
 
+	ra_settle(ra);
 	ra->start = offset;
 	ra->size = get_init_ra_size(size + req_size, max);
 	ra->async_size = ra->size;
@@ -391,7 +479,8 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max = ra_adapt_max(mapping, ra,
+					 max_sane_readahead(ra->ra_pages));
 
 	/*
 	 * start of file
@@ -405,6 +494,7 @@ ondemand_readahead(struct address_space *mapping,
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		ra_account(ra, ra->size);
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
@@ -421,12 +511,13 @@ ondemand_readahead(struct address_space *mapping,
 		pgoff_t start;
 
 		rcu_read_lock();
-		start = radix_tree_next_hole(&mapping->page_tree, offset+1,max);
+		start = page_cache_next_hole(mapping, offset + 1, max);
 		rcu_read_unlock();
 
 		if (!start || start - offset > max)
 			return 0;
 
+		ra_settle(ra);
 		ra->start = start;
 		ra->size = start - offset;	/* old async_size */
 		ra->size += req_size;
@@ -461,6 +552,7 @@ ondemand_readahead(struct address_space *mapping,
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
+	ra_settle(ra);
 	ra->start = offset;
 	ra->size = get_init_ra_size(req_size, max);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
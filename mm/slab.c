@@ -115,6 +115,8 @@
 #include	<linux/reciprocal_div.h>
 #include	<linux/debugobjects.h>
 #include	<linux/kmemcheck.h>
+#include	<linux/sched.h>
+#include	<linux/math64.h>
 
 #include	<asm/cacheflush.h>
 #include	<asm/tlbflush.h>
@@ -126,6 +128,8 @@
  *
  * STATS	- 1 to collect stats for /proc/slabinfo.
  *		  0 for faster, smaller code (especially in the critical paths).
+ *		  The per-cpu hit/miss stats are also kept, without atomic
+ *		  operations, with CONFIG_SLAB_STATS.
  *
  * FORCED_DEBUG	- 1 enables SLAB_RED_ZONE and SLAB_POISON (if possible)
  */
@@ -409,10 +413,6 @@ static void kmem_list3_init(struct kmem_list3 *parent)
 		if ((x)->max_freeable < i)				\
 			(x)->max_freeable = i;				\
 	} while (0)
-#define STATS_INC_ALLOCHIT(x)	atomic_inc(&(x)->allochit)
-#define STATS_INC_ALLOCMISS(x)	atomic_inc(&(x)->allocmiss)
-#define STATS_INC_FREEHIT(x)	atomic_inc(&(x)->freehit)
-#define STATS_INC_FREEMISS(x)	atomic_inc(&(x)->freemiss)
 #else
 #define	STATS_INC_ACTIVE(x)	do { } while (0)
 #define	STATS_DEC_ACTIVE(x)	do { } while (0)
@@ -425,10 +425,33 @@ static void kmem_list3_init(struct kmem_list3 *parent)
 #define	STATS_INC_NODEFREES(x)	do { } while (0)
 #define STATS_INC_ACOVERFLOW(x)   do { } while (0)
 #define	STATS_SET_FREEABLE(x, i) do { } while (0)
+#endif
+
+#ifdef CONFIG_SLAB_STATS
+#define CPU_STATS(x)		(&(x)->cpu_stats[smp_processor_id()])
+#define STATS_INC_ALLOCHIT(x)	(CPU_STATS(x)->allochit++)
+#define STATS_INC_ALLOCMISS(x)	(CPU_STATS(x)->allocmiss++)
+#define STATS_INC_FREEHIT(x)	(CPU_STATS(x)->freehit++)
+#define STATS_INC_FREEMISS(x)	(CPU_STATS(x)->freemiss++)
+#define STATS_CLOCK()		sched_clock()
+#define STATS_ADD_REFILL(x, t)	(CPU_STATS(x)->refill_ns += sched_clock() - (t))
+#define STATS_ADD_FLUSH(x, t)	(CPU_STATS(x)->flush_ns += sched_clock() - (t))
+#elif STATS
+#define STATS_INC_ALLOCHIT(x)	atomic_inc(&(x)->allochit)
+#define STATS_INC_ALLOCMISS(x)	atomic_inc(&(x)->allocmiss)
+#define STATS_INC_FREEHIT(x)	atomic_inc(&(x)->freehit)
+#define STATS_INC_FREEMISS(x)	atomic_inc(&(x)->freemiss)
+#define STATS_CLOCK()		0
+#define STATS_ADD_REFILL(x, t)	do { } while (0)
+#define STATS_ADD_FLUSH(x, t)	do { } while (0)
+#else
 #define STATS_INC_ALLOCHIT(x)	do { } while (0)
 #define STATS_INC_ALLOCMISS(x)	do { } while (0)
 #define STATS_INC_FREEHIT(x)	do { } while (0)
 #define STATS_INC_FREEMISS(x)	do { } while (0)
+#define STATS_CLOCK()		0
+#define STATS_ADD_REFILL(x, t)	do { } while (0)
+#define STATS_ADD_FLUSH(x, t)	do { } while (0)
 #endif
 
 #if DEBUG
@@ -860,6 +883,8 @@ static void next_reap_node(void)
  * Add the CPU number into the expiration time to minimize the possibility of
  * the CPUs getting into lockstep and contending for the global cache chain
  * lock.
+ * The timer is deferrable: an idle CPU is not woken up just to reap, it does
+ * so the next time it wakes up for something else.
  */
 static void __cpuinit start_cpu_timer(int cpu)
 {
@@ -872,7 +897,7 @@ static void __cpuinit start_cpu_timer(int cpu)
 	 */
 	if (keventd_up() && reap_work->work.func == NULL) {
 		init_reap_node(cpu);
-		INIT_DELAYED_WORK(reap_work, cache_reap);
+		INIT_DELAYED_WORK_DEFERRABLE(reap_work, cache_reap);
 		schedule_delayed_work_on(cpu, reap_work,
 					__round_jiffies_relative(HZ, cpu));
 	}
@@ -3101,8 +3126,11 @@ static inline void *____cache_alloc(struct kmem_cache *cachep, gfp_t flags)
 		ac->touched = 1;
 		objp = ac->entry[--ac->avail];
 	} else {
-		STATS_INC_ALLOCMISS(cachep);
+		u64 start = STATS_CLOCK();
+
 		objp = cache_alloc_refill(cachep, flags);
+		STATS_INC_ALLOCMISS(cachep);
+		STATS_ADD_REFILL(cachep, start);
 	}
 	/*
 	 * To avoid a false negative, if an object that is in one of the
@@ -3533,9 +3561,12 @@ static inline void __cache_free(struct kmem_cache *cachep, void *objp)
 		ac->entry[ac->avail++] = objp;
 		return;
 	} else {
+		u64 start = STATS_CLOCK();
+
 		STATS_INC_FREEMISS(cachep);
 		cache_flusharray(cachep, ac);
 		ac->entry[ac->avail++] = objp;
+		STATS_ADD_FLUSH(cachep, start);
 	}
 }
 
@@ -4104,7 +4135,12 @@ static void print_slabinfo_header(struct seq_file *m)
 #if STATS
 	seq_puts(m, " : globalstat <listallocs> <maxobjs> <grown> <reaped> "
 		 "<error> <maxfreeable> <nodeallocs> <remotefrees> <alienoverflow>");
+#endif
+#if STATS || defined(CONFIG_SLAB_STATS)
 	seq_puts(m, " : cpustat <allochit> <allocmiss> <freehit> <freemiss>");
+#endif
+#ifdef CONFIG_SLAB_STATS
+	seq_puts(m, " : slowpath <refill_ns> <flush_ns>");
 #endif
 	seq_putc(m, '\n');
 }
@@ -4211,6 +4247,32 @@ static int s_show(struct seq_file *m, void *p)
 				reaped, errors, max_freeable, node_allocs,
 				node_frees, overflows);
 	}
+#endif
+#ifdef CONFIG_SLAB_STATS
+	/* cpu stats, with the average time of a refill and of a flush */
+	{
+		unsigned long allochit = 0, allocmiss = 0;
+		unsigned long freehit = 0, freemiss = 0;
+		u64 refill_ns = 0, flush_ns = 0;
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct kmem_cache_cpu_stats *s = &cachep->cpu_stats[cpu];
+
+			allochit += s->allochit;
+			allocmiss += s->allocmiss;
+			freehit += s->freehit;
+			freemiss += s->freemiss;
+			refill_ns += s->refill_ns;
+			flush_ns += s->flush_ns;
+		}
+		seq_printf(m, " : cpustat %6lu %6lu %6lu %6lu",
+			   allochit, allocmiss, freehit, freemiss);
+		seq_printf(m, " : slowpath %6llu %6llu",
+			   allocmiss ? div_u64(refill_ns, allocmiss) : 0ULL,
+			   freemiss ? div_u64(flush_ns, freemiss) : 0ULL);
+	}
+#elif STATS
 	/* cpu stats */
 	{
 		unsigned long allochit = atomic_read(&cachep->allochit);
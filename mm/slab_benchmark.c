@@ -0,0 +1,72 @@
+/*
+ * mm/slab_benchmark.c - kmalloc/kfree fast path benchmark.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+
+/*
+ * Time kmalloc/kfree pairs, which the per-cpu array serves without
+ * touching the slab lists, and bursts of BENCH_BURST allocations
+ * followed by as many frees, which make it refill and flush. Results
+ * go to the kernel log at boot.
+ */
+#define BENCH_LOOPS		10000
+#define BENCH_BURST		256
+
+static void *bench_objs[BENCH_BURST] __initdata;
+
+static const size_t bench_sizes[] __initdata = { 32, 128, 512, 2048 };
+
+static u64 __init slab_bench_pairs(size_t size)
+{
+	ktime_t start;
+	void *obj;
+	u64 ns;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		obj = kmalloc(size, GFP_KERNEL);
+		kfree(obj);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return div_u64(ns, BENCH_LOOPS);
+}
+
+static u64 __init slab_bench_bursts(size_t size)
+{
+	ktime_t start;
+	u64 ns;
+	int i, n;
+
+	start = ktime_get();
+	for (n = 0; n < BENCH_LOOPS / BENCH_BURST; n++) {
+		for (i = 0; i < BENCH_BURST; i++)
+			bench_objs[i] = kmalloc(size, GFP_KERNEL);
+		for (i = 0; i < BENCH_BURST; i++)
+			kfree(bench_objs[i]);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return div_u64(ns, (BENCH_LOOPS / BENCH_BURST) * BENCH_BURST);
+}
+
+static int __init slab_benchmark(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++)
+		pr_info("slab benchmark: %4zu bytes: %llu ns per kmalloc/kfree "
+			"pair, %llu ns in bursts of %d\n", bench_sizes[i],
+			slab_bench_pairs(bench_sizes[i]),
+			slab_bench_bursts(bench_sizes[i]), BENCH_BURST);
+	return 0;
+}
+late_initcall(slab_benchmark);
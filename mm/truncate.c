@@ -181,6 +181,46 @@ int invalidate_inode_page(struct page *page)
 	return invalidate_complete_page(mapping, page);
 }
 
+/*
+ * Drop the shadow entries that reclaim left in [start, end], so that they
+ * do not outlive the file data they describe, and so that a dying inode
+ * leaves no radix tree nodes behind.
+ */
+static void truncate_shadow_entries(struct address_space *mapping,
+				    pgoff_t start, pgoff_t end)
+{
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned int i, nr, nr_shadows;
+	pgoff_t next = start;
+
+	while (mapping->nrshadows && next <= end) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots,
+						 indices, next, PAGEVEC_SIZE);
+		if (!nr) {
+			spin_unlock_irq(&mapping->tree_lock);
+			break;
+		}
+		next = indices[nr - 1] + 1;
+
+		nr_shadows = 0;
+		for (i = 0; i < nr && indices[i] <= end; i++)
+			if (radix_tree_exceptional_entry(*slots[i]))
+				indices[nr_shadows++] = indices[i];
+		while (nr_shadows--) {
+			radix_tree_delete(&mapping->page_tree,
+					  indices[nr_shadows]);
+			mapping->nrshadows--;
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (i < nr || !next)
+			break;
+		cond_resched();
+	}
+}
+
 /**
  * truncate_inode_pages - truncate range of pages specified by start & end byte offsets
  * @mapping: mapping to truncate
@@ -214,7 +254,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	pgoff_t next;
 	int i;
 
-	if (mapping->nrpages == 0)
+	if (mapping->nrpages == 0 && mapping->nrshadows == 0)
 		return;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
@@ -287,6 +327,8 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		}
 		pagevec_release(&pvec);
 	}
+
+	truncate_shadow_entries(mapping, start, end);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
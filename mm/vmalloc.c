@@ -1374,12 +1374,9 @@ static void __vunmap(const void *addr, int deallocate_pages)
 	if (deallocate_pages) {
 		int i;
 
-		for (i = 0; i < area->nr_pages; i++) {
-			struct page *page = area->pages[i];
-
-			BUG_ON(!page);
-			__free_page(page);
-		}
+		for (i = 0; i < area->nr_pages; i++)
+			BUG_ON(!area->pages[i]);
+		free_pages_bulk(area->nr_pages, area->pages);
 
 		if (area->flags & VM_VPAGES)
 			vfree(area->pages);
@@ -1493,20 +1490,21 @@ static void *__vmalloc_area_node(struct vm_struct *area, gfp_t gfp_mask,
 		return NULL;
 	}
 
-	for (i = 0; i < area->nr_pages; i++) {
-		struct page *page;
-
-		if (node < 0)
-			page = alloc_page(gfp_mask);
-		else
-			page = alloc_pages_node(node, gfp_mask, 0);
+	if (node < 0) {
+		i = alloc_pages_bulk(gfp_mask, area->nr_pages, area->pages);
+	} else {
+		for (i = 0; i < area->nr_pages; i++) {
+			struct page *page = alloc_pages_node(node, gfp_mask, 0);
 
-		if (unlikely(!page)) {
-			/* Successfully allocated i pages, free them in __vunmap() */
-			area->nr_pages = i;
-			goto fail;
+			if (unlikely(!page))
+				break;
+			area->pages[i] = page;
 		}
-		area->pages[i] = page;
+	}
+	if (unlikely(i < area->nr_pages)) {
+		/* Successfully allocated i pages, free them in __vunmap() */
+		area->nr_pages = i;
+		goto fail;
 	}
 
 	if (map_vm_area(area, prot, &pages))
@@ -128,6 +128,29 @@ struct scan_control {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
+
+/*
+ * Percentage of each zone that POSIX_FADV_HOTCODE may protect, and the
+ * lowest reclaim priority at which the protection still holds: once
+ * reclaim gets more desperate than that, hot code ages like any other
+ * page cache.
+ */
+int vm_hotcode_ratio = 10;
+#define HOTCODE_MIN_PRIORITY	(DEF_PRIORITY - 2)
+
+/**
+ * hotcode_page_allowed - may @page be protected as hot code?
+ * @page: page cache page about to be marked
+ *
+ * Returns true while its zone has hot code budget left.
+ */
+int hotcode_page_allowed(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	return zone_page_state(zone, NR_HOTCODE) <
+		zone->present_pages * vm_hotcode_ratio / 100;
+}
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
 static LIST_HEAD(shrinker_list);
@@ -431,7 +454,8 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
  * Same as remove_mapping, but if the page is removed from the mapping, it
  * gets returned with a refcount of 0.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -476,7 +500,15 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 		spin_unlock_irq(&mapping->tree_lock);
 		swapcache_free(swap, page);
 	} else {
-		__remove_from_page_cache(page);
+		void *shadow = NULL;
+
+		/*
+		 * Remember when a reclaimed page went, so that a refault
+		 * can tell how close it was to staying resident.
+		 */
+		if (reclaimed && page_is_file_cache(page))
+			shadow = workingset_eviction(mapping, page);
+		__delete_from_page_cache(page, shadow);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
 	}
@@ -496,7 +528,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -649,9 +681,9 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * If page which have PG_mlocked lost isoltation race,
 		 * try_to_unmap moves it to unevictable list
 		 */
-		if (sc->order <= PAGE_ALLOC_COSTLY_ORDER &&
-					referenced && page_mapping_inuse(page)
-					&& !(vm_flags & VM_LOCKED))
+		if (sc->order <= PAGE_ALLOC_COSTLY_ORDER && referenced &&
+		    (page_mapping_inuse(page) || PageHotcode(page)) &&
+		    !(vm_flags & VM_LOCKED))
 			goto activate_locked;
 
 		/*
@@ -758,7 +790,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -1320,6 +1352,16 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 			continue;
 		}
 
+		/*
+		 * Hot shared code stays active, referenced or not, until
+		 * reclaim is past moderate pressure. The amount of it is
+		 * bounded by vm_hotcode_ratio when it is marked.
+		 */
+		if (PageHotcode(page) && priority >= HOTCODE_MIN_PRIORITY) {
+			list_add(&page->lru, &l_active);
+			continue;
+		}
+
 		/* page_referenced clears PageReferenced */
 		if (page_mapping_inuse(page) &&
 		    page_referenced(page, 0, sc->mem_cgroup, &vm_flags)) {
@@ -1670,6 +1712,19 @@ static void shrink_zones(int priority, struct zonelist *zonelist,
 						priority != DEF_PRIORITY)
 				continue;	/* Let kswapd poll it */
 			sc->all_unreclaimable = 0;
+			/*
+			 * Take from groups over their soft limit first, as
+			 * kswapd does, so that background groups give up
+			 * their pages before the foreground ones. Only on
+			 * the first pass: groups with nothing left to give
+			 * should not slow down the harder ones.
+			 */
+			if (priority == DEF_PRIORITY)
+				sc->nr_reclaimed +=
+					mem_cgroup_soft_limit_reclaim(zone,
+						sc->order, sc->gfp_mask,
+						zone_to_nid(zone),
+						zone_idx(zone));
 		} else {
 			/*
 			 * Ignore cpuset limitation here. We just want to reduce
@@ -647,6 +647,7 @@ static const char * const vmstat_text[] = {
 	"nr_isolated_anon",
 	"nr_isolated_file",
 	"nr_shmem",
+	"nr_hotcode",
 #ifdef CONFIG_NUMA
 	"numa_hit",
 	"numa_miss",
@@ -671,6 +672,12 @@ static const char * const vmstat_text[] = {
 	"pgfault",
 	"pgmajfault",
 
+	"pgra_submit",
+	"pgra_hit",
+	"pgra_miss",
+	"workingset_refault",
+	"workingset_activate",
+
 	TEXTS_FOR_ZONES("pgrefill")
 	TEXTS_FOR_ZONES("pgsteal")
 	TEXTS_FOR_ZONES("pgscan_kswapd")
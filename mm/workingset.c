@@ -0,0 +1,174 @@
+/*
+ * mm/workingset.c - refault detection for reclaimed page cache
+ *
+ * This file is released under the GPLv2.
+ *
+ * New file pages start on the inactive list and are only promoted when
+ * they are used a second time while still there. When the working set
+ * is bigger than the inactive list but would fit in the whole of memory,
+ * its pages keep being evicted before their second use, and reclaim
+ * never sees a reason to shrink the active list in their favour.
+ *
+ * To tell, each zone counts evictions and activations of file pages in
+ * inactive_age: how far the inactive list has moved. A reclaimed page
+ * leaves a shadow entry in its page cache slot holding that count. When
+ * the page is faulted back in, the difference to the current count is
+ * its refault distance: the minimum number of extra inactive slots that
+ * would have kept it resident. If that is no more than the active file
+ * list, which could give up the space, the page belongs to the working
+ * set and goes straight to the active list, where it competes with the
+ * pages there on equal terms.
+ *
+ * Refaults and the activations they cause are counted in /proc/vmstat
+ * as workingset_refault and workingset_activate. A high ratio of the
+ * latter to the former means the file cache is thrashing.
+ *
+ * Shadow entries go away with refaults, truncation and the inode, but a
+ * mapping that is mostly evicted could otherwise collect them for every
+ * page it ever had. A shadow further back than the active file list can
+ * never lead to an activation, and no mapping can hold more recent ones
+ * than that, so once a mapping has as many shadows as the list has
+ * pages, each eviction first drops a few of its expired shadows, or the
+ * oldest one found if none has expired, near the page going out. New
+ * evictions are always recorded.
+ */
+
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/radix-tree.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 ZONES_SHIFT + NODES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+#define SHADOW_PRUNE_BATCH	16	/* slots looked at per eviction */
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *eviction)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*eviction = entry;
+}
+
+/* Evictions and activations in the shadow's zone since it was stored */
+static unsigned long shadow_distance(void *shadow, struct zone **zone)
+{
+	unsigned long eviction;
+
+	unpack_shadow(shadow, zone, &eviction);
+	return (atomic_long_read(&(*zone)->inactive_age) - eviction) &
+	       EVICTION_MASK;
+}
+
+/*
+ * Drop the expired shadows among the next few entries of @mapping from
+ * @index on, wrapping to the start, or the oldest of them if none has
+ * expired. Called with the mapping's tree_lock held.
+ */
+static void prune_shadows(struct address_space *mapping, pgoff_t index)
+{
+	void **slots[SHADOW_PRUNE_BATCH];
+	unsigned long indices[SHADOW_PRUNE_BATCH];
+	unsigned long distance, oldest = 0;
+	unsigned int i, nr, nr_drop = 0;
+	pgoff_t oldest_index = 0;
+	struct zone *zone;
+
+	nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots, indices,
+					 index, SHADOW_PRUNE_BATCH);
+	if (!nr && index)
+		nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots,
+						 indices, 0,
+						 SHADOW_PRUNE_BATCH);
+
+	for (i = 0; i < nr; i++) {
+		if (!radix_tree_exceptional_entry(*slots[i]))
+			continue;
+		distance = shadow_distance(*slots[i], &zone);
+		if (distance > zone_page_state(zone, NR_ACTIVE_FILE))
+			indices[nr_drop++] = indices[i];
+		else if (distance >= oldest) {
+			oldest = distance;
+			oldest_index = indices[i];
+		}
+	}
+	if (!nr_drop && oldest)
+		indices[nr_drop++] = oldest_index;
+
+	/* deleting may free the nodes that slots[] points into */
+	while (nr_drop--) {
+		radix_tree_delete(&mapping->page_tree, indices[nr_drop]);
+		mapping->nrshadows--;
+	}
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in place of the page. If the
+ * mapping already has as many as can be of use, some old ones are
+ * dropped to make room. Called with the mapping's tree_lock held.
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	if (mapping->nrshadows >= zone_page_state(zone, NR_ACTIVE_FILE))
+		prune_shadows(mapping, page->index + 1);
+	return pack_shadow(eviction, zone);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Returns true if the page should be activated: it was evicted no more
+ * than an active file list's worth of evictions and activations ago.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	struct zone *zone;
+
+	refault_distance = shadow_distance(shadow, &zone);
+
+	count_vm_event(WORKINGSET_REFAULT);
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}